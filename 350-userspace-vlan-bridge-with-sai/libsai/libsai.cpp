@@ -36,7 +36,8 @@ static sai_status_t my_create_switch(
         for (uint32_t i = 0; i < attr_count; ++i) {
             if (attr_list[i].id == SAI_SWITCH_ATTR_FDB_EVENT_NOTIFY) {
                 g_fdb_event_cb = reinterpret_cast<sai_fdb_event_notification_fn>(attr_list[i].value.ptr);
-                break;
+            } else if (attr_list[i].id == SAI_SWITCH_ATTR_FDB_AGING_TIME) {
+                g_switch_state.setFdbAgingTime(attr_list[i].value.u32);
             }
         }
     }
@@ -67,6 +68,24 @@ static sai_status_t my_create_switch(
     return SAI_STATUS_FAILURE;
 }
 
+// ============================================================================
+// SWITCH SET ATTRIBUTE implementation
+// Only SAI_SWITCH_ATTR_FDB_AGING_TIME; takes effect at the next aging sweep.
+// ============================================================================
+static sai_status_t my_set_switch_attribute(
+    [[maybe_unused]] sai_object_id_t switch_id,
+    sai_attribute_t const *attr)
+{
+    switch (attr->id) {
+        case SAI_SWITCH_ATTR_FDB_AGING_TIME:
+            g_switch_state.setFdbAgingTime(attr->value.u32);
+            return SAI_STATUS_SUCCESS;
+
+        default:
+            return SAI_STATUS_NOT_SUPPORTED;
+    }
+}
+
 // ============================================================================
 // Helper: Extract VLAN ID from sai_attribute_t list
 // ============================================================================
@@ -100,10 +119,41 @@ static sai_status_t my_create_vlan(
 
     g_switch_state.createVlan(vlan_id);
 
+    for (uint32_t i = 0; i < attr_count; i++) {
+        if (attr_list[i].id == SAI_VLAN_ATTR_LEARN_DISABLE) {
+            g_switch_state.setVlanLearning(vlan_id, !attr_list[i].value.booldata);
+        }
+    }
+
     *vlan_oid = libsai_encode(ResourceType::Vlan, vlan_id);
     return SAI_STATUS_SUCCESS;
 }
 
+// ============================================================================
+// VLAN SET ATTRIBUTE implementation
+// Only SAI_VLAN_ATTR_LEARN_DISABLE; takes effect for the next frame.
+// ============================================================================
+static sai_status_t my_set_vlan_attribute(
+    sai_object_id_t vlan_oid,
+    sai_attribute_t const *attr)
+{
+    uint16_t const vlan_id = static_cast<uint16_t>(libsai_decode_id(vlan_oid));
+    if (libsai_decode_type(vlan_oid) != ResourceType::Vlan || vlan_id > MaxVlanId) {
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+
+    switch (attr->id) {
+        case SAI_VLAN_ATTR_LEARN_DISABLE:
+            if (!g_switch_state.setVlanLearning(vlan_id, !attr->value.booldata)) {
+                return SAI_STATUS_INVALID_OBJECT_ID;
+            }
+            return SAI_STATUS_SUCCESS;
+
+        default:
+            return SAI_STATUS_NOT_SUPPORTED;
+    }
+}
+
 // ============================================================================
 // VLAN MEMBER CREATE implementation (minimal)
 // ============================================================================
@@ -134,6 +184,10 @@ static sai_status_t my_create_vlan_member(
         }
     }
 
+    if (port_id >= g_switch_state.numPorts()) {
+        return SAI_STATUS_INVALID_PORT_NUMBER;
+    }
+
     g_switch_state.addVlanMember(vlan_id, port_id, tagged);
 
     *member_oid = libsai_encode(ResourceType::Port, port_id);
@@ -141,6 +195,41 @@ static sai_status_t my_create_vlan_member(
 }
 
 
+// ============================================================================
+// BRIDGE PORT SET ATTRIBUTE implementation
+// Only SAI_BRIDGE_PORT_ATTR_FDB_LEARNING_MODE, with the modes that forward
+// the frame; takes effect for the next frame.
+// ============================================================================
+static sai_status_t my_set_bridge_port_attribute(
+    sai_object_id_t bridge_port_oid,
+    sai_attribute_t const *attr)
+{
+    ResourceId const port_id = libsai_decode_id(bridge_port_oid);
+    if (libsai_decode_type(bridge_port_oid) != ResourceType::BridgePort ||
+        port_id >= static_cast<ResourceId>(g_switch_state.numPorts())) {
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+
+    if (attr->id != SAI_BRIDGE_PORT_ATTR_FDB_LEARNING_MODE) {
+        return SAI_STATUS_NOT_SUPPORTED;
+    }
+
+    LearnMode mode;
+    switch (attr->value.s32) {
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_HW:               mode = LearnMode::Hardware; break;
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_DISABLE:          mode = LearnMode::Disable;  break;
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_CPU_LOG:          mode = LearnMode::CpuLog;   break;
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_FDB_NOTIFICATION: mode = LearnMode::Notify;   break;
+        default:
+            // DROP and CPU_TRAP would hold back frames from unknown sources
+            return SAI_STATUS_NOT_SUPPORTED;
+    }
+
+    g_switch_state.setPortLearnMode(static_cast<PortId>(port_id), mode);
+    return SAI_STATUS_SUCCESS;
+}
+
+
 // ============================================================================
 // Switch API Table (minimal)
 // Only initialize_switch() implemented now.
@@ -148,7 +237,7 @@ static sai_status_t my_create_vlan_member(
 static sai_switch_api_t g_my_switch_api = {
     .create_switch              = my_create_switch,
     .remove_switch              = nullptr,
-    .set_switch_attribute       = nullptr,
+    .set_switch_attribute       = my_set_switch_attribute,
     .get_switch_attribute       = nullptr,
     .get_switch_stats           = nullptr,
     .get_switch_stats_ext       = nullptr,
@@ -166,7 +255,7 @@ static sai_switch_api_t g_my_switch_api = {
 static sai_vlan_api_t g_my_vlan_api = {
     .create_vlan                 = my_create_vlan,
     .remove_vlan                 = nullptr,
-    .set_vlan_attribute          = nullptr,
+    .set_vlan_attribute          = my_set_vlan_attribute,
     .get_vlan_attribute          = nullptr,
     .create_vlan_member          = my_create_vlan_member,
     .remove_vlan_member          = nullptr,
@@ -179,6 +268,13 @@ static sai_vlan_api_t g_my_vlan_api = {
     .clear_vlan_stats            = nullptr
 };
 
+static sai_bridge_api_t g_my_bridge_api = {
+    .create_bridge_port          = nullptr,
+    .remove_bridge_port          = nullptr,
+    .set_bridge_port_attribute   = my_set_bridge_port_attribute,
+    .get_bridge_port_attribute   = nullptr
+};
+
 // ============================================================================
 // SAI API QUERY — authentic vendor-style implementation
 // ============================================================================
@@ -197,6 +293,10 @@ sai_status_t sai_api_query(
         *api_method_table = &g_my_vlan_api;
         return SAI_STATUS_SUCCESS;
 
+    case SAI_API_BRIDGE:
+        *api_method_table = &g_my_bridge_api;
+        return SAI_STATUS_SUCCESS;
+
     default:
         return SAI_STATUS_NOT_SUPPORTED;
     }
@@ -213,8 +313,10 @@ copy_mac_bytes(uint8_t (&dst)[6], uint64_t mac)
     dst[5] = static_cast<uint8_t>(mac);
 }
 
-void
-sai_inform_mac_learn(
+// Report an FDB event of one dynamic entry to the registered callback
+static void
+inform_fdb_event(
+    sai_fdb_event_t const event_type,
     uint16_t vlan,
     uint64_t mac,
     uint16_t port
@@ -224,11 +326,6 @@ sai_inform_mac_learn(
         return;
     }
 
-    // // Debug message
-    // std::cout << "[libsai] inform_mac_learn vlan = " << vlan
-    //           << " mac = " << std::hex << mac << std::dec
-    //           << " port = " << port << "\n";
-
     sai_attribute_t attrs[2]{};
     attrs[0].id = SAI_FDB_ENTRY_ATTR_TYPE;
     attrs[0].value.s32 = SAI_FDB_ENTRY_TYPE_DYNAMIC;
@@ -237,7 +334,7 @@ sai_inform_mac_learn(
     attrs[1].value.oid = libsai_encode(ResourceType::Port, port);
 
     sai_fdb_event_notification_data_t event{};
-    event.event_type = SAI_FDB_EVENT_LEARNED;
+    event.event_type = event_type;
     event.attr_count = 2;
     event.attr = attrs;
     event.fdb_entry.switch_id = SAI_NULL_OBJECT_ID;
@@ -247,3 +344,28 @@ sai_inform_mac_learn(
 
     g_fdb_event_cb(1, &event);
 }
+
+void
+sai_inform_mac_learn(
+    uint16_t vlan,
+    uint64_t mac,
+    uint16_t port
+)
+{
+    // // Debug message
+    // std::cout << "[libsai] inform_mac_learn vlan = " << vlan
+    //           << " mac = " << std::hex << mac << std::dec
+    //           << " port = " << port << "\n";
+
+    inform_fdb_event(SAI_FDB_EVENT_LEARNED, vlan, mac, port);
+}
+
+void
+sai_inform_mac_aged(
+    uint16_t vlan,
+    uint64_t mac,
+    uint16_t port
+)
+{
+    inform_fdb_event(SAI_FDB_EVENT_AGED, vlan, mac, port);
+}
@@ -11,4 +11,11 @@ sai_inform_mac_learn(
     uint16_t vlan,
     uint64_t mac,
     uint16_t port
+);
+
+void
+sai_inform_mac_aged(
+    uint16_t vlan,
+    uint64_t mac,
+    uint16_t port
 );
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <saitypes.h>
 #include <saistatus.h>
 #include <saiswitch.h>
+#include <saibridge.h>
 
 typedef enum _sai_api_t {
     SAI_API_UNSPECIFIED = 0,
@@ -15,5 +16,6 @@ typedef enum _sai_api_t {
     SAI_API_PORT        = 2,
     SAI_API_VLAN        = 3,
     SAI_API_FDB         = 4,
+    SAI_API_BRIDGE      = 5,
 } sai_api_t;
 
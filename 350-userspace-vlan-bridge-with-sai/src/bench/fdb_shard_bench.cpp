@@ -0,0 +1,317 @@
+// FDB sharding benchmark: the shared FDB of SwitchState against FDB slices
+// owned by each worker, as in ShardedDataplane, at 2, 4, 8 and 16 threads.
+//
+// Every thread handles its own stream of frames between known hosts; a
+// frame learns (refreshes) its source MAC and looks up its destination
+// MAC, as the learn and lookup stages do.
+//
+//  - shared: learnMac() and lookupFdb() on g_switch_state, under its lock
+//  - sharded: each thread owns the hosts whose FdbKey hashes to it, in its
+//    own FdbHashTable; learns and lookups for hosts of other threads are
+//    handed to their owner through an SPSC ring per pair of threads
+//
+// Threads poll their rings, and yield when idle, instead of waking through
+// an eventfd, and no frames are sent, so the numbers show the FDB and
+// handoff costs only. Threads are not pinned; on fewer cores than threads
+// they timeshare, and the numbers then show the cost per frame rather
+// than how it scales.
+//
+//     fdb_shard_bench [hosts] [frames per thread]
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dataplane/spsc_ring.h"
+#include "state/port_config.h"
+#include "state/switch_state.h"
+
+enum {
+    NumPorts   = 4,
+    BenchVlan  = 73,
+    RingSize   = 1024,  // Messages per ring, as ShardedDataplane::RingSize
+    RingBurst  = 32,    // Messages taken from a ring at once
+    FrameBurst = 32     // Frames between inbox drains
+};
+
+// Source and destination host of a frame
+struct BenchFrame {
+    uint32_t src;
+    uint32_t dst;
+};
+
+// Hosts, and the frame stream of every thread
+struct BenchTraffic {
+    std::vector<MacAddress>              hosts;
+    std::vector<std::vector<BenchFrame>> frames;    // Thread → frames
+};
+
+static PortId host_port(uint32_t const host)
+{
+    return static_cast<PortId>(host % NumPorts);
+}
+
+static BenchTraffic make_traffic(uint32_t const numHosts, unsigned const numThreads,
+                                 size_t const framesPerThread)
+{
+    std::mt19937_64 rng(73);
+    BenchTraffic traffic;
+    for (uint32_t h = 0; h < numHosts; h++) {
+        traffic.hosts.push_back(0x020000000000ULL | (rng() & 0xffffffffffULL));
+    }
+    std::uniform_int_distribution<uint32_t> pick(0, numHosts - 1);
+    traffic.frames.resize(numThreads);
+    for (std::vector<BenchFrame>& frames : traffic.frames) {
+        frames.resize(framesPerThread);
+        for (BenchFrame& frame : frames) {
+            frame = BenchFrame{pick(rng), pick(rng)};
+        }
+    }
+    return traffic;
+}
+
+// Run body(t) on numThreads threads, started together; return seconds
+// until the last one finished
+template <typename Body>
+static double run_threads(unsigned const numThreads, Body&& body)
+{
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t] {
+            ready++;
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            body(t);
+        });
+    }
+    while (ready.load() != numThreads) {
+    }
+    auto const start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// -----------------------------------------------------------------------------
+// Shared FDB
+// -----------------------------------------------------------------------------
+static double bench_shared(BenchTraffic const& traffic, unsigned const numThreads,
+                           std::atomic<uint64_t>& sink)
+{
+    for (uint32_t h = 0; h < traffic.hosts.size(); h++) {
+        g_switch_state.learnMac(BenchVlan, traffic.hosts[h], host_port(h), g_aging_timer.now());
+    }
+    return run_threads(numThreads, [&](unsigned const t) {
+        uint64_t sum = 0;
+        for (BenchFrame const& frame : traffic.frames[t]) {
+            g_switch_state.learnMac(BenchVlan, traffic.hosts[frame.src], host_port(frame.src),
+                                    g_aging_timer.now());
+            PortId port = 0;
+            if (g_switch_state.lookupFdb(BenchVlan, traffic.hosts[frame.dst], port)) {
+                sum += port;
+            }
+        }
+        sink += sum;
+    });
+}
+
+// -----------------------------------------------------------------------------
+// Sharded FDB
+// -----------------------------------------------------------------------------
+class ShardBench {
+public:
+    ShardBench(BenchTraffic const& traffic, unsigned const numThreads)
+        : traffic_(traffic),
+          numThreads_(numThreads)
+    {
+        for (unsigned t = 0; t < numThreads; t++) {
+            workers_.push_back(std::make_unique<Worker>(t, numThreads));
+        }
+        for (uint32_t h = 0; h < traffic.hosts.size(); h++) {
+            learn_fdb_entry(workers_[owner(traffic.hosts[h])]->fdb, BenchVlan, traffic.hosts[h],
+                            host_port(h), 0);
+        }
+    }
+
+    // Thread body of worker t
+    void run(unsigned const t)
+    {
+        Worker& w = *workers_[t];
+        std::vector<BenchFrame> const& frames = traffic_.frames[t];
+        for (size_t i = 0; i < frames.size(); i++) {
+            MacAddress const smac = traffic_.hosts[frames[i].src];
+            MacAddress const dmac = traffic_.hosts[frames[i].dst];
+            unsigned const srcOwner = owner(smac);
+            if (srcOwner == t) {
+                learn_fdb_entry(w.fdb, BenchVlan, smac, host_port(frames[i].src), 0);
+            } else {
+                post(w, srcOwner, Message{Message::Type::Learn, host_port(frames[i].src), smac});
+            }
+            unsigned const dstOwner = owner(dmac);
+            if (dstOwner == t) {
+                lookup(w, dmac);
+            } else {
+                post(w, dstOwner, Message{Message::Type::Lookup, 0, dmac});
+            }
+            if (i % FrameBurst == FrameBurst - 1) {
+                drainInbox(w);
+            }
+        }
+
+        // Serve the other workers until none of them posts any more
+        producersDone_++;
+        while (producersDone_.load() != numThreads_) {
+            if (!drainInbox(w)) {
+                std::this_thread::yield();
+            }
+        }
+        while (drainInbox(w)) {
+        }
+    }
+
+    uint64_t sum() const
+    {
+        uint64_t total = 0;
+        for (auto const& w : workers_) {
+            total += w->sum;
+        }
+        return total;
+    }
+
+private:
+    struct Message {
+        enum class Type : uint8_t {
+            Learn,
+            Lookup
+        };
+
+        Type       type;
+        PortId     port;
+        MacAddress mac;
+    };
+
+    struct Worker {
+        Worker(unsigned const workerId, unsigned const numThreads) : id{workerId}
+        {
+            for (unsigned from = 0; from < numThreads; from++) {
+                inbox.push_back(std::make_unique<SpscRing<Message>>(RingSize));
+            }
+        }
+
+        unsigned const id;
+        FdbHashTable   fdb;
+        uint64_t       sum = 0;   // Ports found
+
+        // One ring per sending worker, indexed by sender
+        std::vector<std::unique_ptr<SpscRing<Message>>> inbox;
+    };
+
+    // Same split as ShardedDataplane::owner()
+    unsigned owner(MacAddress const mac) const
+    {
+        uint64_t const h = FdbHashTable::hash(FdbKey(BenchVlan, mac).packed());
+        return static_cast<unsigned>(((h >> 32) * numThreads_) >> 32);
+    }
+
+    void lookup(Worker& w, MacAddress const mac)
+    {
+        PortId const* const port = w.fdb.find(FdbKey(BenchVlan, mac).packed());
+        w.sum += port ? *port : 0;
+    }
+
+    // Queue msg to worker to; while its ring is full, serve the inbox of w
+    // so that two workers posting to each other cannot stall
+    void post(Worker& w, unsigned const to, Message const& msg)
+    {
+        SpscRing<Message>& ring = *workers_[to]->inbox[w.id];
+        while (!ring.push(msg)) {
+            if (!drainInbox(w)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Handle the messages queued to w; false if there were none
+    bool drainInbox(Worker& w)
+    {
+        std::array<Message, RingBurst> burst;
+        bool any = false;
+        for (auto& ring : w.inbox) {
+            uint32_t const n = ring->popBurst(burst.data(), RingBurst);
+            for (uint32_t i = 0; i < n; i++) {
+                if (burst[i].type == Message::Type::Learn) {
+                    learn_fdb_entry(w.fdb, BenchVlan, burst[i].mac, burst[i].port, 0);
+                } else {
+                    lookup(w, burst[i].mac);
+                }
+            }
+            any = any || n != 0;
+        }
+        return any;
+    }
+
+private:
+    BenchTraffic const&                  traffic_;
+    unsigned const                       numThreads_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<unsigned>                producersDone_{0};
+};
+
+static double bench_sharded(BenchTraffic const& traffic, unsigned const numThreads,
+                            std::atomic<uint64_t>& sink)
+{
+    ShardBench bench(traffic, numThreads);
+    double const secs = run_threads(numThreads, [&](unsigned const t) { bench.run(t); });
+    sink += bench.sum();
+    return secs;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t const numHosts = (argc > 1) ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10))
+                                         : 65536;
+    size_t const framesPerThread = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    if (numHosts == 0 || framesPerThread == 0) {
+        std::fprintf(stderr, "Usage: %s [hosts] [frames per thread]\n", argv[0]);
+        return 1;
+    }
+
+    PortConfig ports(NumPorts);
+    for (size_t p = 0; p < ports.size(); p++) {
+        ports[p].ifname = "bench" + std::to_string(p);
+    }
+    g_switch_state.configurePorts(ports);
+    g_switch_state.reserveFdb(numHosts);
+
+    std::printf("hosts=%u frames/thread=%zu cpus=%u\n", numHosts, framesPerThread,
+                std::thread::hardware_concurrency());
+    std::printf("%-8s %14s %14s %8s\n", "threads", "shared Mfps", "sharded Mfps", "speedup");
+
+    // Sum of the ports found, so that no lookup is optimized away
+    std::atomic<uint64_t> sink{0};
+
+    for (unsigned const numThreads : {2u, 4u, 8u, 16u}) {
+        BenchTraffic const traffic = make_traffic(numHosts, numThreads, framesPerThread);
+        double const frames = static_cast<double>(numThreads * framesPerThread);
+        double const shared = frames / bench_shared(traffic, numThreads, sink) / 1e6;
+        double const sharded = frames / bench_sharded(traffic, numThreads, sink) / 1e6;
+        std::printf("%-8u %14.2f %14.2f %8.2f\n", numThreads, shared, sharded, sharded / shared);
+    }
+
+    std::printf("checksum=%" PRIu64 "\n", sink.load());
+    return 0;
+}
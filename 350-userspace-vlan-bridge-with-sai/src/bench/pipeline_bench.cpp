@@ -0,0 +1,286 @@
+// Pipeline benchmark: cycles per frame through QuietPipeline
+//
+//  - with the port count specialized core against the generic core, at 4,
+//    8, 32 and 64 ports
+//  - for untagged, 802.1Q tagged and QinQ (802.1ad S-tag plus C-tag)
+//    frames, forwarded unicast between access, trunk and provider ports
+//
+// BenchCore stands in for DataplaneCore: it has the same port arrays and
+// walks flood sets with the same for_each_egress_port(), but transmit()
+// only sets the egress tag and counts the frame. The numbers leave out the
+// socket calls, which cost the same in both cores. The cost of reloading
+// the frame into its buffer before each run is measured separately and
+// subtracted.
+//
+//     pipeline_bench [frames] [rounds]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dataplane/cycles.h"
+#include "dataplane/dataplane_core.h"
+#include "dataplane/dataplane_stats.h"
+#include "dataplane/packet_pool.h"
+#include "dataplane/pipeline.h"
+#include "dataplane/storm_control.h"
+#include "state/port_config.h"
+#include "state/switch_state.h"
+
+enum {
+    BenchVlan     = 73,
+    BenchCustVlan = 10,     // C-VLAN of QinQ frames
+
+    // Ports of the tagging run: two of each mode
+    AccessPort    = 0,
+    TrunkPort     = 2,
+    ProviderPort  = 4,
+    TagBenchPorts = 6
+};
+
+constexpr MacAddress BenchBroadcastMac = 0xffffffffffffULL;
+
+// Core parts the pipeline stages use, for up to N ports
+template <PortId N>
+class BenchCore {
+public:
+    explicit BenchCore(PortId const numPorts) : storm_{numPorts}
+    {
+        if constexpr (N == DynamicPortCount) {
+            portStats_.resize(numPorts);
+            tpid_.resize(numPorts);
+        }
+        for (PortId port = 0; port < numPorts; port++) {
+            tpid_[port] = g_switch_state.portSettings(port).tpid;
+        }
+    }
+
+    DataplaneStats& stats() { return stats_; }
+
+    PortStats& portStats(PortId const port) { return portStats_[port]; }
+
+    StormControl& stormControl() { return storm_; }
+
+    // Tag the frame for port, as TxQueue does before sending it
+    void transmit(PortId const port, PacketBuf& pkt, uint16_t const tci)
+    {
+        pkt.setVlanTag(tpid_[port], tci);
+        portStats_[port].txFrames++;
+    }
+
+    template <typename Fn>
+    void forEachPort(EgressPorts const& egress, Fn&& fn) const
+    {
+        for_each_egress_port<N>(egress, std::forward<Fn>(fn));
+    }
+
+private:
+    DataplaneStats              stats_;
+    PortArray<PortStats, N>     portStats_;
+    PortArray<uint16_t, N>      tpid_;
+    StormControl                storm_;
+};
+
+// VLAN tag of a bench frame
+struct BenchTag {
+    uint16_t tpid;
+    uint16_t tci;
+};
+
+// A frame as received, and the port it comes in on
+struct BenchFrame {
+    char const*          name;
+    std::vector<uint8_t> bytes;
+    PortId               port;
+};
+
+// MAC of the host behind port
+static MacAddress host_mac(PortId const port)
+{
+    return 0x020000000100ULL + port;
+}
+
+static void put_mac(std::vector<uint8_t>& bytes, MacAddress const mac)
+{
+    for (int i = MacAddressByteLen - 1; i >= 0; i--) {
+        bytes.push_back(static_cast<uint8_t>(mac >> (8 * i)));
+    }
+}
+
+// 64-byte IPv4 frame from the host of port to dmac, with tags, outer first
+static BenchFrame make_frame(char const* const name, MacAddress const dmac, PortId const port = 0,
+                             std::initializer_list<BenchTag> const tags = {})
+{
+    BenchFrame frame{name, {}, port};
+    put_mac(frame.bytes, dmac);
+    put_mac(frame.bytes, host_mac(port));
+    for (BenchTag const& tag : tags) {
+        frame.bytes.push_back(static_cast<uint8_t>(tag.tpid >> 8));
+        frame.bytes.push_back(static_cast<uint8_t>(tag.tpid));
+        frame.bytes.push_back(static_cast<uint8_t>(tag.tci >> 8));
+        frame.bytes.push_back(static_cast<uint8_t>(tag.tci));
+    }
+    frame.bytes.push_back(0x08);
+    frame.bytes.push_back(0x00);
+    frame.bytes.resize(64, 0x45);
+    return frame;
+}
+
+// Ports untagged members of BenchVlan, with one learned host each
+static void configure_switch(PortId const numPorts)
+{
+    PortConfig ports(numPorts);
+    for (PortId port = 0; port < numPorts; port++) {
+        ports[port].ifname = "bench" + std::to_string(port);
+    }
+    g_switch_state.configurePorts(ports);
+    g_switch_state.createVlan(BenchVlan);
+    for (PortId port = 0; port < numPorts; port++) {
+        g_switch_state.addVlanMember(BenchVlan, port, false);
+        g_switch_state.learnMac(BenchVlan, host_mac(port), port, g_aging_timer.now());
+    }
+}
+
+// Reload frame into pkt, as the receive path leaves it
+static void load_frame(PacketBuf& pkt, BenchFrame const& frame)
+{
+    pkt.data = pkt.base() + PacketHeadroom;
+    pkt.len = static_cast<uint16_t>(frame.bytes.size());
+    std::memcpy(pkt.data, frame.bytes.data(), frame.bytes.size());
+    pkt.vlanTagged = extract_ethertype(pkt.data + 2 * MacAddressByteLen) ==
+                     g_switch_state.portSettings(frame.port).tpid;
+    pkt.port = frame.port;
+}
+
+// Fewest cycles per frame over rounds runs of count frames; run(pkt) is
+// called per frame after the frame is reloaded
+template <typename Run>
+static double cycles_per_frame(PacketBuf& pkt, BenchFrame const& frame, uint32_t const count,
+                               unsigned const rounds, Run&& run)
+{
+    double best = 0;
+    for (unsigned r = 0; r < rounds; r++) {
+        uint64_t const start = read_cycles();
+        for (uint32_t i = 0; i < count; i++) {
+            load_frame(pkt, frame);
+            run(pkt);
+        }
+        double const cycles = static_cast<double>(read_cycles() - start) / count;
+        best = (r == 0) ? cycles : std::min(best, cycles);
+    }
+    return best;
+}
+
+// Cycles per frame of frame through QuietPipeline on a BenchCore<N> of
+// numPorts ports, without the cost of reloading the frame
+template <PortId N>
+static double pipeline_cycles(PortId const numPorts, PacketBuf& pkt, BenchFrame const& frame,
+                              uint32_t const count, unsigned const rounds)
+{
+    BenchCore<N> core(numPorts);
+    double const total = cycles_per_frame(pkt, frame, count, rounds, [&](PacketBuf& p) {
+        FrameContext ctx;
+        ctx.pkt = &p;
+        ctx.port = frame.port;
+        QuietPipeline::process(core, ctx);
+    });
+    double const reload = cycles_per_frame(pkt, frame, count, rounds, [](PacketBuf&) {});
+
+    // A frame the pipeline drops would time the drop path instead.
+    uint64_t sent = 0;
+    for (PortId port = 0; port < numPorts; port++) {
+        sent += core.portStats(port).txFrames;
+    }
+    if (sent == 0) {
+        std::fprintf(stderr, "%s frame was not forwarded\n", frame.name);
+    }
+    return total - reload;
+}
+
+template <PortId N>
+static void bench_ports(PacketBuf& pkt, uint32_t const count, unsigned const rounds)
+{
+    configure_switch(N);
+    BenchFrame const frames[] = {
+        make_frame("unicast", host_mac(1)),
+        make_frame("broadcast", BenchBroadcastMac),
+    };
+    for (BenchFrame const& frame : frames) {
+        double const generic = pipeline_cycles<DynamicPortCount>(N, pkt, frame, count, rounds);
+        double const fixed = pipeline_cycles<N>(N, pkt, frame, count, rounds);
+        std::printf("%-6u %-10s %10.1f %12.1f %+9.1f%%\n", N, frame.name, generic, fixed,
+                    100.0 * (fixed - generic) / generic);
+    }
+}
+
+// Ports in pairs of access (untagged member), trunk (802.1Q tagged
+// member) and provider (802.1ad tagged member) ports of BenchVlan, with
+// one learned host each
+static void configure_tag_switch()
+{
+    PortConfig ports(TagBenchPorts);
+    for (PortId port = 0; port < TagBenchPorts; port++) {
+        ports[port].ifname = "bench" + std::to_string(port);
+        ports[port].tpid = (port >= ProviderPort) ? uint16_t{EthTypeQinQ} : uint16_t{EthTypeVlan};
+    }
+    g_switch_state.configurePorts(ports);
+    g_switch_state.createVlan(BenchVlan);
+    for (PortId port = 0; port < TagBenchPorts; port++) {
+        g_switch_state.addVlanMember(BenchVlan, port, port >= TrunkPort);
+        g_switch_state.learnMac(BenchVlan, host_mac(port), port, g_aging_timer.now());
+    }
+}
+
+// Cost per frame of untagged, single- and double-tagged frames, each
+// forwarded unicast to the other port of its mode, on the generic core
+static void bench_tags(PacketBuf& pkt, uint32_t const count, unsigned const rounds)
+{
+    configure_tag_switch();
+    BenchFrame const frames[] = {
+        make_frame("untagged", host_mac(AccessPort + 1), AccessPort),
+        make_frame("802.1Q", host_mac(TrunkPort + 1), TrunkPort, {{EthTypeVlan, BenchVlan}}),
+        make_frame("QinQ", host_mac(ProviderPort + 1), ProviderPort,
+                   {{EthTypeQinQ, BenchVlan}, {EthTypeVlan, BenchCustVlan}}),
+    };
+    std::printf("%-10s %10s %10s\n", "frame", "cycles", "delta");
+    double untagged = 0;
+    for (BenchFrame const& frame : frames) {
+        double const cycles = pipeline_cycles<DynamicPortCount>(TagBenchPorts, pkt, frame, count, rounds);
+        untagged = (untagged == 0) ? cycles : untagged;
+        std::printf("%-10s %10.1f %+9.1f%%\n", frame.name, cycles,
+                    100.0 * (cycles - untagged) / untagged);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t const count = (argc > 1) ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10))
+                                      : 1000000;
+    unsigned const rounds = (argc > 2) ? static_cast<unsigned>(std::atoi(argv[2])) : 5;
+    if (count == 0 || rounds == 0) {
+        std::fprintf(stderr, "Usage: %s [frames] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    PacketPool pool(PacketPool::CacheSize);
+    PacketPool::Cache cache(pool);
+    PacketBuf* const pkt = pool.alloc(cache);
+
+    std::printf("frames/round=%u rounds=%u, cycles/frame\n", count, rounds);
+    std::printf("%-6s %-10s %10s %12s %10s\n", "ports", "frame", "generic", "specialized", "delta");
+    bench_ports<4>(*pkt, count, rounds);
+    bench_ports<8>(*pkt, count, rounds);
+    bench_ports<32>(*pkt, count, rounds);
+    bench_ports<64>(*pkt, count, rounds);
+
+    std::printf("\nunicast by tagging, %u ports, cycles/frame\n", TagBenchPorts);
+    bench_tags(*pkt, count, rounds);
+
+    pool.release(cache, pkt);
+    return 0;
+}
@@ -0,0 +1,216 @@
+// Port multiplexing benchmark: loop overhead of a poll() array rescanned on
+// every wake-up against the edge-triggered epoll set of DataplaneCore, at
+// 4, 64, 512 and 2048 ports.
+//
+// Every port is the receiving end of a non-blocking AF_UNIX datagram
+// socketpair, standing in for a packet socket. Each iteration sends one
+// frame to one port, then waits, finds the ready port and drains it until
+// EAGAIN, so one port of N is active per wake-up. The numbers are
+// nanoseconds per wake-up, and include the send and receive syscalls,
+// which cost the same either way.
+//
+//     port_mux_bench [wake-ups] [rounds]
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+enum {
+    EpollMaxEvents = 64,    // As DataplaneCore
+    FrameLen       = 64
+};
+
+// Sockets of numPorts ports; the port sockets are polled, and frames are
+// sent to them through their peers
+struct BenchPorts {
+    std::vector<int> fds;
+    std::vector<int> peers;
+
+    explicit BenchPorts(uint32_t const numPorts)
+    {
+        for (uint32_t port = 0; port < numPorts; port++) {
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sv) < 0) {
+                perror("socketpair");
+                std::exit(1);
+            }
+            fds.push_back(sv[0]);
+            peers.push_back(sv[1]);
+        }
+    }
+
+    ~BenchPorts()
+    {
+        for (size_t port = 0; port < fds.size(); port++) {
+            close(fds[port]);
+            close(peers[port]);
+        }
+    }
+
+    BenchPorts(BenchPorts const&) = delete;
+    BenchPorts& operator=(BenchPorts const&) = delete;
+};
+
+// Receive from fd until it has no more frames; return how many it had
+static uint32_t drain(int const fd)
+{
+    std::array<uint8_t, FrameLen> buf;
+    uint32_t frames = 0;
+    while (recv(fd, buf.data(), buf.size(), 0) >= 0) {
+        frames++;
+    }
+    return frames;
+}
+
+// Port that iteration i sends to; strides across all ports
+static uint32_t active_port(uint64_t const i, uint32_t const numPorts)
+{
+    return static_cast<uint32_t>((i * 7919) % numPorts);
+}
+
+static void send_frame(BenchPorts const& ports, uint32_t const port)
+{
+    std::array<uint8_t, FrameLen> const frame{};
+    if (send(ports.peers[port], frame.data(), frame.size(), 0) < 0) {
+        perror("send");
+        std::exit(1);
+    }
+}
+
+// Fewest nanoseconds per wake-up over rounds runs of fn
+template <typename Fn>
+static double ns_per_wakeup(uint64_t const wakeups, unsigned const rounds, Fn&& fn)
+{
+    double best = 0;
+    for (unsigned r = 0; r < rounds; r++) {
+        auto const start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double, std::nano> const elapsed =
+            std::chrono::steady_clock::now() - start;
+        double const perWakeup = elapsed.count() / static_cast<double>(wakeups);
+        best = (r == 0) ? perWakeup : std::min(best, perWakeup);
+    }
+    return best;
+}
+
+// poll() over all ports, then a scan of every revents
+static double bench_poll(BenchPorts const& ports, uint64_t const wakeups, unsigned const rounds)
+{
+    uint32_t const numPorts = static_cast<uint32_t>(ports.fds.size());
+    std::vector<pollfd> pfd(numPorts);
+    for (uint32_t port = 0; port < numPorts; port++) {
+        pfd[port] = pollfd{ports.fds[port], POLLIN, 0};
+    }
+    uint64_t frames = 0;
+    double const ns = ns_per_wakeup(wakeups, rounds, [&] {
+        for (uint64_t i = 0; i < wakeups; i++) {
+            send_frame(ports, active_port(i, numPorts));
+            if (poll(pfd.data(), pfd.size(), -1) < 0) {
+                perror("poll");
+                std::exit(1);
+            }
+            for (uint32_t port = 0; port < numPorts; port++) {
+                if (pfd[port].revents & POLLIN) {
+                    frames += drain(pfd[port].fd);
+                }
+            }
+        }
+    });
+    if (frames != wakeups * rounds) {
+        std::fprintf(stderr, "poll: %" PRIu64 " frames received, expected %" PRIu64 "\n", frames,
+                     wakeups * rounds);
+    }
+    return ns;
+}
+
+// Edge-triggered epoll set with the port id in epoll_data, as DataplaneCore
+static double bench_epoll(BenchPorts const& ports, uint64_t const wakeups, unsigned const rounds)
+{
+    uint32_t const numPorts = static_cast<uint32_t>(ports.fds.size());
+    int const epfd = epoll_create1(EPOLL_CLOEXEC);
+    for (uint32_t port = 0; port < numPorts; port++) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u32 = port;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, ports.fds[port], &ev) < 0) {
+            perror("epoll_ctl");
+            std::exit(1);
+        }
+    }
+    std::array<epoll_event, EpollMaxEvents> events;
+    uint64_t frames = 0;
+    double const ns = ns_per_wakeup(wakeups, rounds, [&] {
+        for (uint64_t i = 0; i < wakeups; i++) {
+            send_frame(ports, active_port(i, numPorts));
+            int const ret = epoll_wait(epfd, events.data(), EpollMaxEvents, -1);
+            if (ret < 0) {
+                perror("epoll_wait");
+                std::exit(1);
+            }
+            for (int e = 0; e < ret; e++) {
+                frames += drain(ports.fds[events[e].data.u32]);
+            }
+        }
+    });
+    close(epfd);
+    if (frames != wakeups * rounds) {
+        std::fprintf(stderr, "epoll: %" PRIu64 " frames received, expected %" PRIu64 "\n", frames,
+                     wakeups * rounds);
+    }
+    return ns;
+}
+
+// Raise the open file limit to fit fds descriptors; false if the hard
+// limit is lower
+static bool reserve_fds(rlim_t const fds)
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0) {
+        return false;
+    }
+    if (limit.rlim_cur >= fds) {
+        return true;
+    }
+    if (limit.rlim_max < fds) {
+        return false;
+    }
+    limit.rlim_cur = fds;
+    return setrlimit(RLIMIT_NOFILE, &limit) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t const wakeups = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 50000;
+    unsigned const rounds = (argc > 2) ? static_cast<unsigned>(std::atoi(argv[2])) : 3;
+    if (wakeups == 0 || rounds == 0) {
+        std::fprintf(stderr, "Usage: %s [wake-ups] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("wake-ups/round=%" PRIu64 " rounds=%u, ns/wake-up\n", wakeups, rounds);
+    std::printf("%-6s %10s %10s %8s\n", "ports", "poll", "epoll", "speedup");
+    for (uint32_t const numPorts : {4u, 64u, 512u, 2048u}) {
+        // Two sockets per port, plus stdio and the epoll descriptor
+        if (!reserve_fds(2 * numPorts + 16)) {
+            std::printf("%-6u skipped: open file limit too low\n", numPorts);
+            continue;
+        }
+        BenchPorts const ports(numPorts);
+        double const polled = bench_poll(ports, wakeups, rounds);
+        double const epolled = bench_epoll(ports, wakeups, rounds);
+        std::printf("%-6u %10.0f %10.0f %8.2f\n", numPorts, polled, epolled, polled / epolled);
+    }
+    return 0;
+}
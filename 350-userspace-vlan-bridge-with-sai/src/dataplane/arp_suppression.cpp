@@ -0,0 +1,184 @@
+#include "arp_suppression.h"
+#include "switch_dataplane.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+enum {
+    // ARP for IPv4 over Ethernet
+    ArpLen       = 28,
+    ArpHwEther   = 1,
+    ArpRequest   = 1,
+    ArpReply     = 2,
+
+    // Neighbor discovery messages (ICMPv6) and their options
+    NdSolicit    = 135,
+    NdAdvert     = 136,
+    NdMsgLen     = 24,      // Up to the options
+    NdOptSource  = 1,       // Source link-layer address
+    NdOptTarget  = 2,       // Target link-layer address
+
+    Ipv6HeaderLen = 40,
+    Ipv4AddrLen   = 4
+};
+
+static uint16_t read_u16(uint8_t const* const p)
+{
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+// IPv4 address addr as an IPv4-mapped IPv6 address
+static IpAddress ipv4_mapped(uint8_t const* const addr)
+{
+    IpAddress ip{};
+    ip[10] = 0xff;
+    ip[11] = 0xff;
+    std::memcpy(ip.data() + 12, addr, Ipv4AddrLen);
+    return ip;
+}
+
+static IpAddress ipv6_address(uint8_t const* const addr)
+{
+    IpAddress ip;
+    std::memcpy(ip.data(), addr, ip.size());
+    return ip;
+}
+
+// Bind ip to mac, unless mac is not a host's
+static void learn_binding(VlanId const vlan, IpAddress const& ip, MacAddress const mac)
+{
+    if (mac == 0 || classify_mac(mac) != MacClass::Unicast) {
+        return;
+    }
+    if (g_switch_state.learnNeighbor(vlan, ip, mac, g_aging_timer.now())) {
+        bool const v4 = std::all_of(ip.begin(), ip.begin() + 10, [](uint8_t b) { return b == 0; }) &&
+                        ip[10] == 0xff && ip[11] == 0xff;
+        char ipStr[INET6_ADDRSTRLEN];
+        ::inet_ntop(v4 ? AF_INET : AF_INET6, v4 ? ip.data() + 12 : ip.data(), ipStr, sizeof(ipStr));
+        MacString const macStr = macToString(mac);
+        ::printf("[DP] neighbor vlan = %d, ip = %s is at mac = %s\n", vlan, ipStr, macStr.data());
+    }
+}
+
+// Look up the target of a request; outOwner receives the MAC it is bound to
+static NeighLookup lookup_target(VlanId const vlan, IpAddress const& target, MacAddress& outOwner)
+{
+    return g_switch_state.lookupNeighbor(vlan, target, outOwner) ? NeighLookup::Hit
+                                                                  : NeighLookup::Miss;
+}
+
+// -----------------------------------------------------------------------------
+// ARP
+// -----------------------------------------------------------------------------
+
+// Snoop ARP message arp of len bytes; request tells if it was sent to a
+// group address
+static NeighLookup snoop_arp(VlanId const vlan, bool const learn, bool const request,
+                             uint8_t const* const arp, size_t const len, MacAddress& outOwner)
+{
+    if (len < ArpLen || read_u16(arp) != ArpHwEther || read_u16(arp + 2) != ETH_P_IP ||
+        arp[4] != MacAddressByteLen || arp[5] != Ipv4AddrLen) {
+        return NeighLookup::None;
+    }
+    uint16_t const op = read_u16(arp + 6);
+    uint8_t const* const senderMac = arp + 8;
+    uint8_t const* const senderIp = arp + 14;
+    uint8_t const* const targetIp = arp + 24;
+
+    // A probe (sender 0.0.0.0) binds nothing, and must reach every host.
+    static uint8_t const anyIp[Ipv4AddrLen] = {};
+    if (std::equal(senderIp, senderIp + Ipv4AddrLen, anyIp)) {
+        return NeighLookup::None;
+    }
+    if (learn && (op == ArpRequest || op == ArpReply)) {
+        learn_binding(vlan, ipv4_mapped(senderIp), extract_mac(senderMac));
+    }
+
+    bool const gratuitous = std::equal(senderIp, senderIp + Ipv4AddrLen, targetIp);
+    if (!request || op != ArpRequest || gratuitous) {
+        return NeighLookup::None;
+    }
+    return lookup_target(vlan, ipv4_mapped(targetIp), outOwner);
+}
+
+// -----------------------------------------------------------------------------
+// Neighbor discovery
+// -----------------------------------------------------------------------------
+
+// Link-layer address of option type among the ND options of len bytes at
+// opts; 0 if none
+static MacAddress nd_option_mac(uint8_t const* opts, size_t len, uint8_t const type)
+{
+    while (len >= 8) {
+        size_t const optLen = size_t{opts[1]} * 8;
+        if (optLen == 0 || optLen > len) {
+            return 0;
+        }
+        if (opts[0] == type && optLen >= 2 + MacAddressByteLen) {
+            return extract_mac(opts + 2);
+        }
+        opts += optLen;
+        len -= optLen;
+    }
+    return 0;
+}
+
+// Snoop IPv6 packet ip of len bytes, if it is a neighbor solicitation or
+// advertisement; request tells if it was sent to a group address
+static NeighLookup snoop_nd(VlanId const vlan, bool const learn, bool const request,
+                            uint8_t const* const ip, size_t len, MacAddress& outOwner)
+{
+    if (len < Ipv6HeaderLen || (ip[0] >> 4) != 6 || ip[6] != IPPROTO_ICMPV6) {
+        return NeighLookup::None;
+    }
+    len = std::min<size_t>(len, Ipv6HeaderLen + read_u16(ip + 4));
+    uint8_t const* const msg = ip + Ipv6HeaderLen;
+    if (len < Ipv6HeaderLen + NdMsgLen || (msg[0] != NdSolicit && msg[0] != NdAdvert)) {
+        return NeighLookup::None;
+    }
+    uint8_t const* const opts = msg + NdMsgLen;
+    size_t const optsLen = len - Ipv6HeaderLen - NdMsgLen;
+    IpAddress const source = ipv6_address(ip + 8);
+    IpAddress const target = ipv6_address(msg + 8);
+
+    if (msg[0] == NdAdvert) {
+        if (learn) {
+            learn_binding(vlan, target, nd_option_mac(opts, optsLen, NdOptTarget));
+        }
+        return NeighLookup::None;
+    }
+
+    // Duplicate address detection (source ::) binds nothing, and must
+    // reach every host.
+    if (source == IpAddress{}) {
+        return NeighLookup::None;
+    }
+    if (learn) {
+        learn_binding(vlan, source, nd_option_mac(opts, optsLen, NdOptSource));
+    }
+    if (!request || source == target) {
+        return NeighLookup::None;
+    }
+    return lookup_target(vlan, target, outOwner);
+}
+
+// -----------------------------------------------------------------------------
+NeighLookup arp_nd_snoop(VlanId const vlan, LearnMode const learn, uint16_t const type,
+                         uint8_t const* const frame, size_t const len, MacAddress& outOwner)
+{
+    // Payload behind up to two VLAN tags
+    size_t const offset = payload_offset(frame, len);
+    uint8_t const* const p = frame + offset;
+    size_t const l3Len = len - offset;
+
+    bool const learnBinding = learn == LearnMode::Hardware;
+    bool const request = classify_mac(extract_mac(frame)) != MacClass::Unicast;
+    if (type == ETH_P_ARP) {
+        return snoop_arp(vlan, learnBinding, request, p, l3Len, outOwner);
+    }
+    return snoop_nd(vlan, learnBinding, request, p, l3Len, outOwner);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "switch_state.h"
+
+#include <net/ethernet.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// ARP and ND suppression.
+//
+// Most flooded frames in a VLAN are ARP requests and neighbor solicitations
+// for hosts the switch already heard from. The dataplane hands each ARP
+// frame, and each IPv6 frame, to arp_nd_snoop(), which:
+//
+//  - learns the sender binding of ARP requests and replies, the source of
+//    neighbor solicitations, and the target of neighbor advertisements,
+//    into the neighbor table of SwitchState, if the source MAC of the frame
+//    is learned (LearnMode::Hardware)
+//  - looks up the target of ARP requests and neighbor solicitations sent
+//    to a group address; if the target is bound, the dataplane forwards
+//    the request like a unicast frame to the owner's MAC, so it reaches
+//    one port instead of the whole VLAN, and the owner answers it
+//
+// Requests that probe for a duplicate address (sender 0.0.0.0 or ::) or
+// announce the sender's own address (gratuitous ARP) are left to flood. A
+// request whose owner the FDB does not know floods as well.
+// -----------------------------------------------------------------------------
+
+// Outcome of arp_nd_snoop() for a frame
+enum class NeighLookup : uint8_t {
+    None,   // Not a request to a group address, or not suppressible
+    Hit,    // Request for a bound target
+    Miss    // Request for a target without binding; it floods
+};
+
+// True if frames of payload ethertype type may be ARP or ND
+inline bool is_arp_nd_ethertype(uint16_t const type)
+{
+    return type == ETH_P_ARP || type == ETH_P_IPV6;
+}
+
+// Snoop the frame of len bytes, with payload ethertype type, received on a
+// port of learning mode learn and classified into vlan. On Hit, outOwner
+// receives the MAC the target is bound to.
+NeighLookup arp_nd_snoop(VlanId vlan, LearnMode learn, uint16_t type, uint8_t const* frame,
+                         size_t len, MacAddress& outOwner);
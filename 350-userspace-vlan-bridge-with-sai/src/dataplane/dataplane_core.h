@@ -0,0 +1,462 @@
+#pragma once
+
+#include "switch_dataplane.h"
+#include "switch_state.h"
+#include "dataplane_stats.h"
+#include "pipeline.h"
+#include "packet_pool.h"
+#include "tx_queue.h"
+#include "ingress_scheduler.h"
+#include "cycles.h"
+#include "latency_histogram.h"
+#include "poll_governor.h"
+#include "link_monitor.h"
+#include "storm_control.h"
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Events taken per epoll_wait() of the dataplane core
+constexpr int EpollMaxEvents = 64;
+
+// Port count of the generic core, whose port arrays are sized at runtime
+constexpr PortId DynamicPortCount = 0;
+
+// Epoll id of the link monitor's attach eventfd; ports use their port id
+constexpr uint32_t EpollAttachId = ~0u;
+
+// Per-port storage: constexpr-sized for a fixed port count, vector otherwise
+template <typename T, PortId N>
+using PortArray = std::conditional_t<N == DynamicPortCount,
+                                     std::vector<T>,
+                                     std::array<T, N>>;
+
+// Invoke fn(port) for every port of egress: for a fixed port count N, by
+// walking the set bits of its bitmap; for DynamicPortCount, from its port
+// list. The walk costs one step per egress port, where a loop over all N
+// ports (even unrolled) costs N; pipeline_bench shows the difference on
+// broadcasts at 32 and 64 ports.
+template <PortId N, typename Fn>
+inline void for_each_egress_port(EgressPorts const& egress, Fn&& fn)
+{
+    if constexpr (N == DynamicPortCount) {
+        for (PortId p : egress.ports) {
+            fn(p);
+        }
+    } else {
+        for (PortBitmap mask = egress.bitmap; mask != 0; mask &= mask - 1) {
+            fn(static_cast<PortId>(std::countr_zero(mask)));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// DataplaneCore: receive loop for up to N ports, running every frame through
+// FramePipeline (see pipeline.h).
+//
+// With a fixed N, all port arrays are constexpr-sized, and flood sets are
+// walked by their set bits.
+//
+// The ports sit in an edge-triggered epoll set, with the port id in
+// epoll_data, so a wake-up costs O(ready ports) however many ports the
+// switch has. A port reported readable goes on the ready list of the
+// ingress scheduler and stays there until it is drained; EPOLLOUT is
+// only watched while the port has frames queued.
+//
+// N == DynamicPortCount is the generic core for any number of ports.
+//
+// Interfaces that appear while the switch runs are opened by the
+// LinkMonitor, which hands their sockets over through an eventfd in the
+// same epoll set; the core swaps them in for the port's old socket.
+//
+// How the loop waits for frames (block, busy poll, or adapt between them)
+// is up to a PollGovernor. In every mode, each frame's latency from its
+// kernel receive timestamp to the end of the pipeline goes into a
+// histogram, and so does the latency of the first frame after each
+// wake-up from a sleeping state; their percentiles are part of the stats
+// dump.
+// -----------------------------------------------------------------------------
+template <PortId N, typename FramePipeline>
+class DataplaneCore {
+    static_assert(N <= PortBitmapMaxPorts, "fixed port masks cover up to 64 ports");
+
+public:
+    // Frames are received into buffers of pool; hot-attached ports come
+    // from linkMonitor
+    DataplaneCore(PortId numPorts, PacketPool& pool, DataplaneConfig const& config,
+                  LinkMonitor& linkMonitor);
+
+    // Run the dataplane loop; never returns
+    [[noreturn]] void run();
+
+    // -------------------------------------------------------------------------
+    // Used by pipeline stages
+    // -------------------------------------------------------------------------
+    DataplaneStats& stats() { return stats_; }
+
+    PortStats& portStats(PortId port) { return portStats_[port]; }
+
+    StormControl& stormControl() { return storm_; }
+
+    // Send frame to port with VLAN tag tci (untagged if 0), or queue it
+    // if the port is busy
+    void transmit(PortId port, PacketBuf& pkt, uint16_t tci);
+
+    // Invoke fn(port) for every port of egress
+    template <typename Fn>
+    void forEachPort(EgressPorts const& egress, Fn&& fn) const;
+
+private:
+    // Set up the socket fd of port and add it to the epoll set; false if
+    // busy polling is on but SO_BUSY_POLL is not available
+    bool addPort(PortId port, int fd);
+
+    // Swap in the sockets the link monitor opened for new interfaces
+    void attachPorts();
+
+    // Watch port for EPOLLOUT as well as EPOLLIN, or stop doing so
+    void watchTx(PortId port, bool on);
+
+    // Receive one frame from port and run it through the pipeline;
+    // false if the port has no frame (or no buffer is free)
+    bool receiveFrame(PortId port);
+
+    // Send the frames queued to port
+    void flushTx(PortId port);
+
+    // Print counters if they moved since the last dump
+    void dumpStats();
+
+private:
+    PortId const              numPorts_;   // Ports of the switch
+    PortArray<int, N>         fds_;        // Port → socket
+    int                       epfd_;       // Epoll set of all ports
+    PortArray<uint8_t, N>     txWatched_;  // Port → EPOLLOUT watched
+    std::vector<PortId>       stalled_;    // Ready ports left unread, no buffer
+    PortArray<PortStats, N>   portStats_;  // Port → counters
+    PortArray<TxQueue, N>     txq_;        // Port → egress queue
+    IngressScheduler          ingress_;    // Order in which ports are read
+    StormControl              storm_;      // Flood rate limits per port
+    bool const                busyPoll_;   // Spin instead of sleeping in poll()
+    PollGovernor              governor_;   // How the loop waits for frames
+    bool                      wakeup_ = false;  // Next frame ends a sleep
+    DataplaneStats            stats_;
+    LatencyHistogram          latency_;    // Kernel receive → pipeline done
+    LatencyHistogram          wakeupLatency_;  // Same, first frame after a sleep
+    uint64_t                  rxFramesDumped_ = 0;
+    uint64_t                  loopPasses_ = 0;  // Wake-ups with events
+    uint64_t                  loopCycles_ = 0;  // Their cycles outside the pipeline
+
+    PacketPool&               pool_;
+    PacketPool::Cache         cache_;      // This thread's buffer cache
+    LinkMonitor&              linkMonitor_;
+};
+
+
+// -----------------------------------------------------------------------------
+template <PortId N, typename FramePipeline>
+DataplaneCore<N, FramePipeline>::DataplaneCore(
+    PortId numPorts,
+    PacketPool& pool,
+    DataplaneConfig const& config,
+    LinkMonitor& linkMonitor)
+    : numPorts_{numPorts},
+      ingress_{numPorts, config.portWeights},
+      storm_{numPorts},
+      busyPoll_{config.busyPoll},
+      governor_{config.busyPoll ? PollGovernor::Mode::BusyPoll
+                : config.adaptivePoll ? PollGovernor::Mode::Adaptive
+                : PollGovernor::Mode::Blocking,
+                config.adaptiveIdleUsecs, IngressBurstMax},
+      pool_{pool},
+      cache_{pool},
+      linkMonitor_{linkMonitor}
+{
+    if constexpr (N == DynamicPortCount) {
+        fds_.resize(numPorts_);
+        txWatched_.resize(numPorts_);
+        portStats_.resize(numPorts_);
+        txq_.resize(numPorts_);
+    } else {
+        fds_.fill(-1);
+        txWatched_.fill(0);
+    }
+    for (PortId port = 0; port < numPorts_; port++) {
+        txq_[port].setTpid(g_switch_state.portSettings(port).tpid);
+    }
+    stalled_.reserve(numPorts_);
+
+    std::vector<pollfd> pfd(numPorts_);
+    initialize_fds(fds_.data(), pfd.data(), numPorts_);
+
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd_ < 0) {
+        perror("epoll_create1");
+        exit(1);
+    }
+    // Ports that failed to open stay down until the link monitor
+    // attaches them.
+    bool busyPollSockets = true;
+    for (PortId port = 0; port < numPorts_; port++) {
+        int const fd = fds_[port];
+        fds_[port] = -1;
+        if (fd >= 0)
+            busyPollSockets &= addPort(port, fd);
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = EpollAttachId;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, linkMonitor_.attachFd(), &ev) < 0) {
+        perror("epoll_ctl");
+        exit(1);
+    }
+
+    if (busyPoll_) {
+        std::cout << "[DP] busy polling, SO_BUSY_POLL "
+                  << (busyPollSockets ? "enabled" : "not available") << "\n";
+    }
+}
+
+template <PortId N, typename FramePipeline>
+void DataplaneCore<N, FramePipeline>::run()
+{
+    std::array<epoll_event, EpollMaxEvents> events;
+
+    // ------------------------------------------------------------------
+    // Dataplane Loop
+    // ------------------------------------------------------------------
+    for (;;) {
+
+        // Ports still ready from the last pass need no wait.
+        int const timeout = ingress_.hasReady() ? 0 : governor_.prepare();
+        int const ret = epoll_wait(epfd_, events.data(), EpollMaxEvents, timeout);
+        if (ret < 0) {
+            if (errno != EINTR)
+                perror("epoll_wait");
+            continue;
+        }
+        uint64_t const passStart = read_cycles();
+        uint64_t const procCycles = stats_.procCycles;
+
+        for (int i = 0; i < ret; i++) {
+            if (events[i].data.u32 == EpollAttachId) {
+                attachPorts();
+                continue;
+            }
+
+            PortId const port = events[i].data.u32;
+            if (events[i].events & EPOLLERR)
+                clear_port_error(fds_[port]);
+
+            if (events[i].events & EPOLLOUT)
+                flushTx(port);
+
+            if (events[i].events & EPOLLIN)
+                ingress_.markReady(port);
+        }
+
+        uint32_t served = 0;
+        if (ingress_.hasReady()) {
+            wakeup_ = governor_.sleeping();
+            served = ingress_.serveReady(IngressBurstMax, portStats_.data(),
+                                         [this](PortId const port) { return receiveFrame(port); });
+
+            // On buffer exhaustion, the frames stay in the socket and the
+            // port on the ready list; no new edge would report them.
+            for (PortId port : stalled_) {
+                ingress_.markReady(port);
+            }
+            stalled_.clear();
+        }
+
+        if (served > 0) {
+            governor_.busy(served);
+        } else if (governor_.idle()) {
+            dumpStats();
+        }
+
+        if (ret > 0) {
+            loopPasses_++;
+            loopCycles_ += read_cycles() - passStart - (stats_.procCycles - procCycles);
+        }
+    }
+}
+
+template <PortId N, typename FramePipeline>
+bool DataplaneCore<N, FramePipeline>::addPort(PortId const port, int const fd)
+{
+    // A replaced socket is bound to an interface that is gone.
+    if (fds_[port] >= 0) {
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, fds_[port], nullptr);
+        close(fds_[port]);
+    }
+    fds_[port] = fd;
+    txWatched_[port] = 0;
+
+    enable_rx_timestamps(fd);
+    bool const busyPollSocket = !busyPoll_ || enable_socket_busy_poll(fd);
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u32 = port;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        exit(1);
+    }
+    return busyPollSocket;
+}
+
+template <PortId N, typename FramePipeline>
+void DataplaneCore<N, FramePipeline>::attachPorts()
+{
+    uint64_t count;
+    if (read(linkMonitor_.attachFd(), &count, sizeof(count)) < 0) {
+        return;
+    }
+
+    PortId port;
+    int fd;
+    while (linkMonitor_.takeAttach(port, fd)) {
+        addPort(port, fd);
+
+        // Frames queued for the old socket go out on the new one.
+        if (!txq_[port].empty()) {
+            watchTx(port, true);
+        }
+    }
+}
+
+template <PortId N, typename FramePipeline>
+bool DataplaneCore<N, FramePipeline>::receiveFrame(PortId const port)
+{
+    ssize_t const minFrameLen = 2 * MacAddressByteLen + 2;
+
+    // On exhaustion, leave the frame in the socket for later.
+    PacketBuf* const pkt = pool_.alloc(cache_);
+    if (!pkt) {
+        stalled_.push_back(port);
+        return false;
+    }
+
+    uint64_t latency = 0;
+    ssize_t const n = recv_port_frame(fds_[port], *pkt, g_switch_state.portSettings(port).tpid, &latency);
+    if (n < 0) {
+        // Drained
+        pool_.release(cache_, pkt);
+        return false;
+    }
+    if (n < minFrameLen) {
+        pool_.release(cache_, pkt);
+        return true;
+    }
+    pkt->port = port;
+
+    uint64_t const start = read_cycles();
+    FrameContext ctx;
+    ctx.pkt = pkt;
+    ctx.port = port;
+    FramePipeline::process(*this, ctx);
+    stats_.procCycles += read_cycles() - start;
+
+    if (latency != 0) {
+        latency_.record(latency);
+        if (wakeup_) {
+            wakeupLatency_.record(latency);
+        }
+    }
+    wakeup_ = false;
+
+    pool_.release(cache_, pkt);
+    return true;
+}
+
+template <PortId N, typename FramePipeline>
+void DataplaneCore<N, FramePipeline>::transmit(
+    PortId const port,
+    PacketBuf& pkt,
+    uint16_t const tci)
+{
+    TxQueue& txq = txq_[port];
+    txq.transmit(fds_[port], &pkt, tci, portStats_[port]);
+    if (!txq.empty()) {
+        watchTx(port, true);
+    }
+}
+
+template <PortId N, typename FramePipeline>
+void DataplaneCore<N, FramePipeline>::flushTx(PortId const port)
+{
+    TxQueue& txq = txq_[port];
+    txq.flush(fds_[port], pool_, cache_, portStats_[port]);
+    if (txq.empty()) {
+        watchTx(port, false);
+    }
+}
+
+template <PortId N, typename FramePipeline>
+void DataplaneCore<N, FramePipeline>::watchTx(PortId const port, bool const on)
+{
+    if (txWatched_[port] == on) {
+        return;
+    }
+    txWatched_[port] = on;
+
+    epoll_event ev = {};
+    ev.events = on ? (EPOLLIN | EPOLLOUT | EPOLLET) : (EPOLLIN | EPOLLET);
+    ev.data.u32 = port;
+    if (epoll_ctl(epfd_, EPOLL_CTL_MOD, fds_[port], &ev) < 0) {
+        perror("epoll_ctl");
+    }
+}
+
+template <PortId N, typename FramePipeline>
+template <typename Fn>
+void DataplaneCore<N, FramePipeline>::forEachPort(EgressPorts const& egress, Fn&& fn) const
+{
+    for_each_egress_port<N>(egress, std::forward<Fn>(fn));
+}
+
+template <PortId N, typename FramePipeline>
+void DataplaneCore<N, FramePipeline>::dumpStats()
+{
+    // Idle; dump the counters if they moved since the last dump.
+    if (stats_.rxFrames() == rxFramesDumped_) {
+        return;
+    }
+    rxFramesDumped_ = stats_.rxFrames();
+
+    std::cout << "== Dataplane Stats ==\n";
+    std::cout << stats_.tostring();
+    std::cout << latency_.tostring();
+    if (wakeupLatency_.count() != 0) {
+        std::cout << "wakeup " << wakeupLatency_.tostring();
+    }
+    std::cout << governor_.tostring();
+    ::printf("loop: passes=%" PRIu64 " cycles/pass=%" PRIu64 "\n",
+        loopPasses_, loopPasses_ ? loopCycles_ / loopPasses_ : 0);
+    size_t queued = 0;
+    for (PortId port = 0; port < numPorts_; port++) {
+        std::cout << portStats_[port].tostring(port, txq_[port].size());
+        queued += txq_[port].size();
+    }
+    std::cout << tostring_lag_stats(portStats_);
+    std::cout << g_switch_state.tostringMcast();
+    std::cout << pool_.tostring();
+    std::cout << std::endl;
+
+    // Only the TX queues hold frames between loop iterations.
+    pool_.checkLeaks(queued);
+}
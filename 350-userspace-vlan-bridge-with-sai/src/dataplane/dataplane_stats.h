@@ -0,0 +1,164 @@
+#pragma once
+
+#include "switch_state.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// -----------------------------------------------------------------------------
+// DataplaneStats: frame counters of the dataplane thread.
+// Only the dataplane thread updates them, so they are plain integers.
+// -----------------------------------------------------------------------------
+struct DataplaneStats {
+    uint64_t rxUnicast   = 0;   // Received, unicast dmac
+    uint64_t rxMulticast = 0;   // Received, multicast dmac
+    uint64_t rxBroadcast = 0;   // Received, broadcast dmac
+
+    uint64_t fwdUnicast   = 0;  // Forwarded to the port found in FDB
+    uint64_t fwdMulticast = 0;  // Forwarded to the ports of a snooped group,
+                                // or, if a report or leave, the router ports
+    uint64_t floodUnknown = 0;  // Flooded, unicast dmac not in FDB
+    uint64_t floodGroup   = 0;  // Flooded, multicast/broadcast dmac
+    uint64_t vlanDrops    = 0;  // Tagged for a VLAN the ingress port is not in
+    uint64_t mcastSnooped = 0;  // IGMP / MLD messages punted to snooping
+    uint64_t neighHits    = 0;  // ARP / ND requests sent to the bound owner
+    uint64_t neighMisses  = 0;  // ARP / ND requests flooded, target not bound
+
+    uint64_t procCycles   = 0;  // Cycles spent processing received frames
+
+    // Count a received frame by its dmac class
+    void countRx(MacClass const dmacClass)
+    {
+        switch (dmacClass) {
+            case MacClass::Unicast:   rxUnicast++;   break;
+            case MacClass::Multicast: rxMulticast++; break;
+            case MacClass::Broadcast: rxBroadcast++; break;
+        }
+    }
+
+    uint64_t rxFrames() const
+    {
+        return rxUnicast + rxMulticast + rxBroadcast;
+    }
+
+    // Add the counters of another thread
+    DataplaneStats& operator+=(DataplaneStats const& other)
+    {
+        rxUnicast    += other.rxUnicast;
+        rxMulticast  += other.rxMulticast;
+        rxBroadcast  += other.rxBroadcast;
+        fwdUnicast   += other.fwdUnicast;
+        fwdMulticast += other.fwdMulticast;
+        floodUnknown += other.floodUnknown;
+        floodGroup   += other.floodGroup;
+        vlanDrops    += other.vlanDrops;
+        mcastSnooped += other.mcastSnooped;
+        neighHits    += other.neighHits;
+        neighMisses  += other.neighMisses;
+        procCycles   += other.procCycles;
+        return *this;
+    }
+
+    // String representation of the counters
+    std::string tostring() const
+    {
+        uint64_t const frames = rxFrames();
+        uint64_t const cyclesPerFrame = frames ? procCycles / frames : 0;
+
+        char buf[384];
+        int const n = std::snprintf(buf, sizeof(buf),
+            "rx: unicast=%" PRIu64 " multicast=%" PRIu64 " broadcast=%" PRIu64 "\n"
+            "fwd: unicast=%" PRIu64 " multicast=%" PRIu64 " flood-unknown=%" PRIu64
+            " flood-group=%" PRIu64 " vlan-drops=%" PRIu64 "\n"
+            "mcast-snooped=%" PRIu64 " arp-nd-suppression: hits=%" PRIu64 " misses=%" PRIu64 "\n"
+            "cycles/frame=%" PRIu64 "\n",
+            rxUnicast, rxMulticast, rxBroadcast,
+            fwdUnicast, fwdMulticast, floodUnknown, floodGroup, vlanDrops,
+            mcastSnooped, neighHits, neighMisses,
+            cyclesPerFrame);
+        return (n > 0) ? std::string(buf, static_cast<size_t>(n)) : std::string{};
+    }
+};
+
+// -----------------------------------------------------------------------------
+// PortStats: per-port frame counters of the dataplane thread
+// -----------------------------------------------------------------------------
+struct PortStats {
+    uint64_t rxFrames    = 0;
+    uint64_t rxTurns     = 0;  // Ingress scheduler rounds that served the port
+    uint64_t rxThrottled = 0;  // Rounds that ended with the port still backlogged
+    uint64_t txFrames    = 0;  // Handed to the socket
+    uint64_t txDrops     = 0;  // TX queue full, or send failed
+    uint64_t txRetries   = 0;  // Sends of queued frames on POLLOUT
+    uint32_t txQueueMax  = 0;  // Highest TX queue depth seen
+
+    uint64_t stormDropsBroadcast = 0;  // Received floods over the storm
+    uint64_t stormDropsMulticast = 0;  // control limit of the port
+    uint64_t stormDropsUnknown   = 0;
+
+    // Count a frame dropped by storm control by its dmac class
+    void countStormDrop(MacClass const dmacClass)
+    {
+        switch (dmacClass) {
+            case MacClass::Unicast:   stormDropsUnknown++;   break;
+            case MacClass::Multicast: stormDropsMulticast++; break;
+            case MacClass::Broadcast: stormDropsBroadcast++; break;
+        }
+    }
+
+    // Add the counters of another thread
+    PortStats& operator+=(PortStats const& other)
+    {
+        rxFrames    += other.rxFrames;
+        rxTurns     += other.rxTurns;
+        rxThrottled += other.rxThrottled;
+        txFrames    += other.txFrames;
+        txDrops     += other.txDrops;
+        txRetries   += other.txRetries;
+        txQueueMax   = std::max(txQueueMax, other.txQueueMax);
+        stormDropsBroadcast += other.stormDropsBroadcast;
+        stormDropsMulticast += other.stormDropsMulticast;
+        stormDropsUnknown   += other.stormDropsUnknown;
+        return *this;
+    }
+
+    // String representation of the counters, given the current TX queue depth
+    std::string tostring(PortId const port, uint32_t const txQueued) const
+    {
+        char buf[384];
+        int const n = std::snprintf(buf, sizeof(buf),
+            "port %u: rx=%" PRIu64 " rx-turns=%" PRIu64 " rx-throttled=%" PRIu64 " "
+            "tx=%" PRIu64 " txq=%u (max %u) tx-drops=%" PRIu64 " tx-retries=%" PRIu64 " "
+            "storm-drops: bcast=%" PRIu64 " mcast=%" PRIu64 " unknown=%" PRIu64 "\n",
+            port, rxFrames, rxTurns, rxThrottled,
+            txFrames, txQueued, txQueueMax, txDrops, txRetries,
+            stormDropsBroadcast, stormDropsMulticast, stormDropsUnknown);
+        return (n > 0) ? std::string(buf, static_cast<size_t>(n)) : std::string{};
+    }
+};
+
+// String representation of how the frames sent to each LAG spread over its
+// members, given the counters of all ports, indexed by port; one line per
+// LAG, none without LAGs
+template <typename Ports>
+std::string tostring_lag_stats(Ports const& ports)
+{
+    std::string out;
+    for (auto const& [lagPort, members] : g_switch_state.lagMembers()) {
+        uint64_t total = 0;
+        for (PortId const member : members) {
+            total += ports[member].txFrames;
+        }
+        out += "lag " + std::to_string(lagPort) + ": tx=" + std::to_string(total);
+        for (PortId const member : members) {
+            uint64_t const tx = ports[member].txFrames;
+            out += " port " + std::to_string(member) + "=" + std::to_string(tx) +
+                   " (" + std::to_string(total ? tx * 100 / total : 0) + "%)";
+        }
+        out += "\n";
+    }
+    return out;
+}
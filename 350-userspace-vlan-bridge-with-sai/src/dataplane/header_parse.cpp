@@ -0,0 +1,186 @@
+#include "header_parse.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Load 16 bits in network byte order
+static inline uint16_t load_be16(uint8_t const* const p)
+{
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return __builtin_bswap16(v);
+}
+
+// Fill ethertype/tci/tagged of frame i, given the type field at offset 12.
+// A double-tagged (QinQ) frame has the type of its payload behind the
+// inner tag.
+static inline void parse_tag(uint8_t const* const p, size_t const i, HeaderBurst& out)
+{
+    uint16_t const type = load_be16(p + 2 * MacAddressByteLen);
+    bool const tagged = is_vlan_tpid(type);
+    out.tagged[i] = tagged;
+    out.tci[i] = tagged ? load_be16(p + 2 * MacAddressByteLen + 2) : 0;
+    if (!tagged) {
+        out.ethtype[i] = type;
+        return;
+    }
+    uint16_t const inner = load_be16(p + 2 * MacAddressByteLen + VlanTagByteLen);
+    out.ethtype[i] = is_vlan_tpid(inner)
+        ? load_be16(p + 2 * MacAddressByteLen + 2 * VlanTagByteLen) : inner;
+}
+
+// -----------------------------------------------------------------------------
+// Scalar
+// -----------------------------------------------------------------------------
+static void parse_headers_scalar(uint8_t const* const* frames, size_t const count, HeaderBurst& out)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint8_t const* const p = frames[i];
+        out.dmac[i] = extract_mac(p);
+        out.smac[i] = extract_mac(p + MacAddressByteLen);
+        parse_tag(p, i, out);
+    }
+}
+
+#if defined(__x86_64__)
+// -----------------------------------------------------------------------------
+// SSE4: one 16-byte load per frame; a shuffle byte-swaps dmac into the low
+// and smac into the high 64-bit lane.
+// -----------------------------------------------------------------------------
+__attribute__((target("sse4.1")))
+static void parse_headers_sse4(uint8_t const* const* frames, size_t const count, HeaderBurst& out)
+{
+    __m128i const swapMacs = _mm_setr_epi8(
+        5, 4, 3, 2, 1, 0, -1, -1,
+        11, 10, 9, 8, 7, 6, -1, -1);
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t const* const p = frames[i];
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+        __m128i const macs = _mm_shuffle_epi8(v, swapMacs);
+        out.dmac[i] = static_cast<MacAddress>(_mm_cvtsi128_si64(macs));
+        out.smac[i] = static_cast<MacAddress>(_mm_extract_epi64(macs, 1));
+        parse_tag(p, i, out);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// AVX2: two frames per 256-bit register, one per 128-bit lane.
+// -----------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void parse_headers_avx2(uint8_t const* const* frames, size_t const count, HeaderBurst& out)
+{
+    __m256i const swapMacs = _mm256_setr_epi8(
+        5, 4, 3, 2, 1, 0, -1, -1,
+        11, 10, 9, 8, 7, 6, -1, -1,
+        5, 4, 3, 2, 1, 0, -1, -1,
+        11, 10, 9, 8, 7, 6, -1, -1);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        uint8_t const* const p0 = frames[i];
+        uint8_t const* const p1 = frames[i + 1];
+        __m256i const v = _mm256_loadu2_m128i(
+            reinterpret_cast<__m128i const*>(p1),
+            reinterpret_cast<__m128i const*>(p0));
+        __m256i const macs = _mm256_shuffle_epi8(v, swapMacs);
+        out.dmac[i]     = static_cast<MacAddress>(_mm256_extract_epi64(macs, 0));
+        out.smac[i]     = static_cast<MacAddress>(_mm256_extract_epi64(macs, 1));
+        out.dmac[i + 1] = static_cast<MacAddress>(_mm256_extract_epi64(macs, 2));
+        out.smac[i + 1] = static_cast<MacAddress>(_mm256_extract_epi64(macs, 3));
+        parse_tag(p0, i, out);
+        parse_tag(p1, i + 1, out);
+    }
+
+    // Odd tail frame
+    if (i < count) {
+        uint8_t const* const p = frames[i];
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+        __m128i const macs = _mm_shuffle_epi8(v, _mm256_castsi256_si128(swapMacs));
+        out.dmac[i] = static_cast<MacAddress>(_mm_cvtsi128_si64(macs));
+        out.smac[i] = static_cast<MacAddress>(_mm_extract_epi64(macs, 1));
+        parse_tag(p, i, out);
+    }
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Runtime selection
+// -----------------------------------------------------------------------------
+typedef void (*ParseHeadersFn)(uint8_t const* const*, size_t, HeaderBurst&);
+
+struct HeaderParser {
+    ParseHeadersFn fn;
+    char const*    name;
+};
+
+// Parser of variant; fn is null if the variant is not built in or the CPU
+// lacks its instructions
+static HeaderParser variant_parser(ParseVariant const variant)
+{
+    switch (variant) {
+    case ParseVariant::Scalar:
+        return HeaderParser{parse_headers_scalar, "scalar"};
+#if defined(__x86_64__)
+    case ParseVariant::Sse4:
+        __builtin_cpu_init();
+        return HeaderParser{__builtin_cpu_supports("sse4.1") ? parse_headers_sse4 : nullptr, "sse4"};
+    case ParseVariant::Avx2:
+        __builtin_cpu_init();
+        return HeaderParser{__builtin_cpu_supports("avx2") ? parse_headers_avx2 : nullptr, "avx2"};
+#else
+    case ParseVariant::Sse4:
+        return HeaderParser{nullptr, "sse4"};
+    case ParseVariant::Avx2:
+        return HeaderParser{nullptr, "avx2"};
+#endif
+    }
+    return HeaderParser{nullptr, "unknown"};
+}
+
+// Fastest supported variant
+static HeaderParser select_parser()
+{
+    for (ParseVariant const variant : {ParseVariant::Avx2, ParseVariant::Sse4}) {
+        HeaderParser const parser = variant_parser(variant);
+        if (parser.fn != nullptr) {
+            return parser;
+        }
+    }
+    return variant_parser(ParseVariant::Scalar);
+}
+
+static HeaderParser const& header_parser()
+{
+    static HeaderParser const parser = select_parser();
+    return parser;
+}
+
+void parse_headers(uint8_t const* const* frames, size_t const count, HeaderBurst& out)
+{
+    assert(count <= MaxHeaderBurst);
+    header_parser().fn(frames, count, out);
+}
+
+char const* header_parser_name()
+{
+    return header_parser().name;
+}
+
+bool parse_variant_supported(ParseVariant const variant)
+{
+    return variant_parser(variant).fn != nullptr;
+}
+
+void parse_headers_variant(ParseVariant const variant, uint8_t const* const* frames,
+                           size_t const count, HeaderBurst& out)
+{
+    assert(count <= MaxHeaderBurst);
+    ParseHeadersFn const fn = variant_parser(variant).fn;
+    assert(fn != nullptr);
+    fn(frames, count, out);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "switch_state.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum {
+    // Largest burst parse_headers() handles in one call
+    MaxHeaderBurst = 256,
+
+    // Bytes parse_headers() may read from the start of each frame buffer.
+    // Frames may be shorter, but their buffers must be at least this long.
+    HeaderParseReadLen = 2 * MacAddressByteLen + 2 * VlanTagByteLen + 2
+};
+
+// -----------------------------------------------------------------------------
+// HeaderBurst: Ethernet headers of a burst of frames, as structure of
+// arrays. Entry i describes frame i of the burst.
+// -----------------------------------------------------------------------------
+struct HeaderBurst {
+    std::array<MacAddress, MaxHeaderBurst> dmac;
+    std::array<MacAddress, MaxHeaderBurst> smac;
+    std::array<uint16_t, MaxHeaderBurst>   ethtype;  // After up to two VLAN tags
+    std::array<uint16_t, MaxHeaderBurst>   tci;      // TCI of the outer tag; 0 if untagged
+    std::array<uint8_t, MaxHeaderBurst>    tagged;   // 1 if the outer tag is 802.1Q or 802.1ad
+};
+
+// Implementations of parse_headers()
+enum class ParseVariant : uint8_t {
+    Scalar,
+    Sse4,
+    Avx2
+};
+
+// Parse the Ethernet headers of count frames into out.
+//
+// Uses unaligned 16-byte loads plus byte shuffles to assemble both MACs at
+// once, with AVX2 (two frames per instruction) or SSE4 variants picked at
+// runtime from the CPU features, and a scalar fallback. test/header_parse_test
+// checks every variant against extract_mac() and extract_ethertype().
+void parse_headers(uint8_t const* const* frames, size_t count, HeaderBurst& out);
+
+// Name of the variant used by parse_headers(), e.g. "avx2"
+char const* header_parser_name();
+
+// True if variant is built in and the CPU supports it
+bool parse_variant_supported(ParseVariant variant);
+
+// parse_headers() with the given variant, which must be supported
+void parse_headers_variant(ParseVariant variant, uint8_t const* const* frames, size_t count,
+                           HeaderBurst& out);
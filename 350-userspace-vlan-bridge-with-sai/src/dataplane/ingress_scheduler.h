@@ -0,0 +1,182 @@
+#pragma once
+
+#include "switch_state.h"
+#include "dataplane_stats.h"
+
+#include <poll.h>
+
+#include <cstdint>
+#include <vector>
+
+enum {
+    // Frames received per unit of port weight per round
+    DrrQuantum = 8,
+
+    // Frames received per poll() wake-up, before pending egress is retried
+    IngressBurstMax = 256
+};
+
+// -----------------------------------------------------------------------------
+// IngressScheduler: deficit round robin over the ingress ports.
+//
+// Each round, every readable port earns DrrQuantum * weight frames of
+// credit and is read until the credit runs out or the socket is drained;
+// a drained port forfeits what is left. Rounds repeat until all ports are
+// drained or the frame budget of the call is spent, and the first port of
+// a round rotates between calls. A saturated port thus gets its weighted
+// share and no more, however many frames it has queued, and cannot delay
+// the other ports by more than one quantum.
+//
+// serve() scans a pollfd array for readable ports. With edge-triggered
+// readiness (epoll), the caller instead marks ports ready as events come
+// in, and serveReady() runs the same DRR over the list of ready ports
+// only, so a round costs O(ready ports) rather than O(ports). A ready port
+// stays on the list until it is drained, as its next edge only comes
+// after that.
+// -----------------------------------------------------------------------------
+class IngressScheduler {
+public:
+    // weights: port → weight; missing ports and 0 weigh 1
+    IngressScheduler(PortId numPorts, std::vector<uint32_t> const& weights)
+        : weight_(numPorts, 1),
+          deficit_(numPorts, 0),
+          ready_(numPorts, 0),
+          active_(numPorts)
+    {
+        for (PortId port = 0; port < numPorts && port < weights.size(); port++) {
+            if (weights[port] != 0) {
+                weight_[port] = weights[port];
+            }
+        }
+    }
+
+    uint32_t weight(PortId const port) const { return weight_[port]; }
+
+    // Receive up to maxFrames frames from the ports of pfd with POLLIN set,
+    // by calling recv(port), which returns false once the port is drained.
+    // Clears POLLIN of drained ports. Return the frames received.
+    template <typename RecvFn>
+    uint32_t serve(pollfd* pfd, uint32_t maxFrames, PortStats* stats, RecvFn&& recv);
+
+    // Add port to the ready list, unless it is on it already
+    void markReady(PortId const port)
+    {
+        if (!ready_[port]) {
+            ready_[port] = 1;
+            active_[(activeHead_ + activeCount_) % active_.size()] = port;
+            activeCount_++;
+        }
+    }
+
+    // True if some port is ready and not yet drained
+    bool hasReady() const { return activeCount_ != 0; }
+
+    // Receive up to maxFrames frames from the ready ports, by calling
+    // recv(port) as in serve(). Drained ports leave the ready list.
+    // Return the frames received.
+    template <typename RecvFn>
+    uint32_t serveReady(uint32_t maxFrames, PortStats* stats, RecvFn&& recv);
+
+private:
+    std::vector<uint32_t> weight_;    // Port → weight
+    std::vector<uint32_t> deficit_;   // Port → frames it may still receive
+    PortId                first_ = 0; // First port of the next round
+
+    // Ready list of serveReady(): FIFO of ports, in DRR order
+    std::vector<uint8_t>  ready_;     // Port → on the ready list
+    std::vector<PortId>   active_;    // Ring of ready ports
+    size_t                activeHead_ = 0;
+    size_t                activeCount_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+template <typename RecvFn>
+uint32_t IngressScheduler::serve(
+    pollfd* const pfd,
+    uint32_t const maxFrames,
+    PortStats* const stats,
+    RecvFn&& recv)
+{
+    PortId const numPorts = static_cast<PortId>(weight_.size());
+    uint32_t served = 0;
+
+    bool backlog = true;
+    while (backlog && served < maxFrames) {
+        backlog = false;
+
+        PortId port = first_;
+        for (PortId k = 0; k < numPorts && served < maxFrames; k++) {
+            if (pfd[port].revents & POLLIN) {
+                PortStats& portStats = stats[port];
+                deficit_[port] += DrrQuantum * weight_[port];
+                portStats.rxTurns++;
+
+                while (deficit_[port] > 0 && served < maxFrames) {
+                    if (!recv(port)) {
+                        pfd[port].revents = static_cast<short>(pfd[port].revents & ~POLLIN);
+                        deficit_[port] = 0;
+                        break;
+                    }
+                    deficit_[port]--;
+                    served++;
+                }
+
+                if (pfd[port].revents & POLLIN) {
+                    backlog = true;
+                    if (deficit_[port] == 0) {
+                        portStats.rxThrottled++;
+                    }
+                }
+            }
+            port = (port + 1 == numPorts) ? 0 : port + 1;
+        }
+    }
+
+    first_ = (first_ + 1 == numPorts) ? 0 : first_ + 1;
+    return served;
+}
+
+template <typename RecvFn>
+uint32_t IngressScheduler::serveReady(
+    uint32_t const maxFrames,
+    PortStats* const stats,
+    RecvFn&& recv)
+{
+    size_t const slots = active_.size();
+    uint32_t served = 0;
+
+    while (activeCount_ != 0 && served < maxFrames) {
+        PortId const port = active_[activeHead_];
+        PortStats& portStats = stats[port];
+
+        // A port left at the head by a spent budget resumes its turn.
+        if (deficit_[port] == 0) {
+            deficit_[port] = DrrQuantum * weight_[port];
+            portStats.rxTurns++;
+        }
+
+        bool drained = false;
+        while (deficit_[port] > 0 && served < maxFrames) {
+            if (!recv(port)) {
+                drained = true;
+                break;
+            }
+            deficit_[port]--;
+            served++;
+        }
+
+        if (drained) {
+            deficit_[port] = 0;
+            ready_[port] = 0;
+            activeHead_ = (activeHead_ + 1) % slots;
+            activeCount_--;
+        } else if (deficit_[port] == 0) {
+            // Quantum spent, still backlogged: to the back of the list
+            portStats.rxThrottled++;
+            activeHead_ = (activeHead_ + 1) % slots;
+            active_[(activeHead_ + activeCount_ - 1) % slots] = port;
+        }
+    }
+
+    return served;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// -----------------------------------------------------------------------------
+// LatencyHistogram: log-linear histogram of latencies in nanoseconds.
+//
+// Every power of two is split into SubBuckets linear buckets, so a
+// percentile is exact below SubBuckets ns and within 1/SubBuckets of the
+// true value above. Recording is a count-leading-zeros and an increment;
+// the histogram is owned by one thread.
+// -----------------------------------------------------------------------------
+class LatencyHistogram {
+public:
+    enum {
+        SubBucketBits = 3,
+        SubBuckets    = 1 << SubBucketBits,
+        NumBuckets    = 64 * SubBuckets
+    };
+
+    void record(uint64_t const ns)
+    {
+        buckets_[bucketOf(ns)]++;
+        count_++;
+        if (ns > max_) {
+            max_ = ns;
+        }
+    }
+
+    uint64_t count() const { return count_; }
+
+    // Smallest latency that at least q (0..1) of the samples do not exceed,
+    // rounded down to its bucket
+    uint64_t percentile(double const q) const
+    {
+        uint64_t const rank = static_cast<uint64_t>(q * static_cast<double>(count_));
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < NumBuckets; i++) {
+            seen += buckets_[i];
+            if (seen > rank) {
+                return lowerBound(i);
+            }
+        }
+        return max_;
+    }
+
+    // String representation of the percentiles
+    std::string tostring() const
+    {
+        char buf[160];
+        int const n = std::snprintf(buf, sizeof(buf),
+            "latency: samples=%" PRIu64 " p50=%" PRIu64 "ns p99=%" PRIu64 "ns"
+            " p999=%" PRIu64 "ns max=%" PRIu64 "ns\n",
+            count_, percentile(0.5), percentile(0.99), percentile(0.999), max_);
+        return (n > 0) ? std::string(buf, static_cast<size_t>(n)) : std::string{};
+    }
+
+private:
+    static uint32_t bucketOf(uint64_t const ns)
+    {
+        if (ns < SubBuckets) {
+            return static_cast<uint32_t>(ns);
+        }
+        uint32_t const msb = 63 - static_cast<uint32_t>(__builtin_clzll(ns));
+        uint32_t const shift = msb - SubBucketBits;
+        return (shift + 1) * SubBuckets +
+               static_cast<uint32_t>((ns >> shift) & (SubBuckets - 1));
+    }
+
+    static uint64_t lowerBound(uint32_t const bucket)
+    {
+        if (bucket < SubBuckets) {
+            return bucket;
+        }
+        uint32_t const shift = bucket / SubBuckets - 1;
+        return (uint64_t{SubBuckets} + bucket % SubBuckets) << shift;
+    }
+
+private:
+    std::array<uint64_t, NumBuckets> buckets_{};
+    uint64_t                         count_ = 0;
+    uint64_t                         max_ = 0;
+};
@@ -0,0 +1,173 @@
+#include "link_monitor.h"
+#include "switch_dataplane.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <tuple>
+
+// -----------------------------------------------------------------------------
+LinkMonitor::LinkMonitor(bool const hotAttach)
+    : hotAttach_{hotAttach}
+{
+    PortId const numPorts = static_cast<PortId>(g_switch_state.numPorts());
+    for (PortId port = 0; port < numPorts; port++) {
+        ports_[g_switch_state.portSettings(port).ifname] = port;
+    }
+    reported_.assign(numPorts, 0);
+
+    nlfd_ = netlink_open_link_events();
+    if (nlfd_ < 0) {
+        std::cerr << "[DP] link changes will not be followed\n";
+    }
+
+    if (hotAttach_) {
+        attachFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (attachFd_ < 0) {
+            perror("eventfd");
+            exit(1);
+        }
+    }
+}
+
+void LinkMonitor::start()
+{
+    if (nlfd_ < 0) {
+        return;
+    }
+    std::thread([this] { run(); }).detach();
+}
+
+bool LinkMonitor::takeAttach(PortId& outPort, int& outFd)
+{
+    std::lock_guard lock(mtx_);
+    if (pending_.empty()) {
+        return false;
+    }
+    std::tie(outPort, outFd) = pending_.front();
+    pending_.erase(pending_.begin());
+    return true;
+}
+
+void LinkMonitor::run()
+{
+    LinkEventFn const onEvent =
+        [this](std::string const& ifname, LinkInfo const& link, bool const deleted) {
+            onLink(ifname, link, deleted);
+        };
+
+    for (;;) {
+        if (!netlink_read_link_events(nlfd_, onEvent)) {
+            std::cerr << "[DP] link notifications lost, resyncing\n";
+            resync();
+        }
+    }
+}
+
+void LinkMonitor::onLink(std::string const& ifname, LinkInfo const& link, bool const deleted)
+{
+    auto const it = ports_.find(ifname);
+    if (it == ports_.end()) {
+        return;
+    }
+    PortId const port = it->second;
+    int const bound = g_switch_state.portIfindex(port);
+
+    if (deleted) {
+        if (link.ifindex == bound) {
+            g_switch_state.setPortIfindex(port, 0);
+            setOperUp(port, ifname, false);
+        }
+        return;
+    }
+
+    // A new interface under the port's name
+    if (link.ifindex != bound && !attach(port, ifname, link.ifindex)) {
+        setOperUp(port, ifname, false);
+        return;
+    }
+    setOperUp(port, ifname, link.operUp());
+}
+
+void LinkMonitor::resync()
+{
+    LinkTable links;
+    if (!netlink_dump_links(links)) {
+        std::cerr << "[DP] netlink link dump failed\n";
+        return;
+    }
+    for (auto const& [ifname, port] : ports_) {
+        auto const it = links.find(ifname);
+        if (it != links.end()) {
+            onLink(ifname, it->second, false);
+            continue;
+        }
+        LinkInfo gone;
+        gone.ifindex = g_switch_state.portIfindex(port);
+        if (gone.ifindex != 0) {
+            onLink(ifname, gone, true);
+        }
+    }
+}
+
+bool LinkMonitor::attach(PortId const port, std::string const& ifname, int const ifindex)
+{
+    if (!hotAttach_) {
+        if (reported_[port] != ifindex) {
+            reported_[port] = ifindex;
+            std::cerr << "[DP] port=" << port << " " << ifname
+                      << " appeared; restart the switch to attach it\n";
+        }
+        return false;
+    }
+
+    std::string err;
+    int const fd = open_port_socket(ifindex, err);
+    if (fd < 0) {
+        std::cerr << "[DP] port=" << port << " " << ifname << ": " << err << "\n";
+        return false;
+    }
+    g_switch_state.setPortIfindex(port, ifindex);
+    {
+        std::lock_guard lock(mtx_);
+        pending_.emplace_back(port, fd);
+    }
+    uint64_t const one = 1;
+    if (write(attachFd_, &one, sizeof(one)) < 0) {
+        perror("write(eventfd)");
+    }
+    std::cout << "[DP] port=" << port << " attached to " << ifname << "\n";
+    return true;
+}
+
+void LinkMonitor::setOperUp(PortId const port, std::string const& ifname, bool const up)
+{
+    size_t lagMoved = 0;
+    if (!g_switch_state.setPortOperUp(port, up, &lagMoved)) {
+        return;
+    }
+    PortId const lagPort = g_switch_state.lagPort(port);
+    if (up) {
+        std::cout << "[DP] port=" << port << " " << ifname << " up";
+        if (g_switch_state.isLag(lagPort)) {
+            std::cout << ", LAG " << lagPort << " moved " << lagMoved << " of "
+                      << LagBuckets << " hash buckets";
+        }
+        std::cout << "\n";
+        return;
+    }
+
+    // A LAG keeps its FDB entries while it has a member up; its flows
+    // move to the other members.
+    if (g_switch_state.isLagUp(lagPort)) {
+        std::cout << "[DP] port=" << port << " " << ifname << " down, LAG " << lagPort
+                  << " moved " << lagMoved << " of " << LagBuckets << " hash buckets\n";
+        return;
+    }
+    size_t const flushed = g_switch_state.flushFdbPort(lagPort);
+    std::cout << "[DP] port=" << port << " " << ifname << " down, flushed "
+              << flushed << " FDB entries\n";
+}
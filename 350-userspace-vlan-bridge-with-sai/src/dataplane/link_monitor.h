@@ -0,0 +1,72 @@
+#pragma once
+
+#include "netlink_link.h"
+#include "switch_state.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// LinkMonitor: follows link changes of the port interfaces (RTNLGRP_LINK)
+// on its own thread.
+//
+//  - Link down or removed: the port is marked down, which takes it out of
+//    all flood sets, and its FDB entries are flushed; a LAG member's
+//    flows move to the other members, and the LAG's entries are only
+//    flushed once all its members are down
+//  - Link up: the port is marked up again
+//  - Interface added, or removed and added again under a new ifindex:
+//    with hot attach, a socket is opened for it and handed to the
+//    dataplane through attachFd() / takeAttach(); without, the port
+//    stays down until the switch restarts
+//
+// The netlink socket is opened in the constructor, before the dataplane
+// resolves its ports, so no change between the two is lost. If the kernel
+// drops notifications (ENOBUFS), the monitor resyncs with a link dump.
+// -----------------------------------------------------------------------------
+class LinkMonitor {
+public:
+    explicit LinkMonitor(bool hotAttach);
+
+    // Start the monitor thread, once the dataplane has bound its ports
+    void start();
+
+    // Eventfd that is readable while sockets wait to be attached; -1
+    // without hot attach
+    int attachFd() const { return attachFd_; }
+
+    // Take the next socket to attach, with its port; false if none
+    bool takeAttach(PortId& outPort, int& outFd);
+
+private:
+    // Monitor thread
+    [[noreturn]] void run();
+
+    // Apply a link change of ifname
+    void onLink(std::string const& ifname, LinkInfo const& link, bool deleted);
+
+    // Bring every port in line with a fresh link dump
+    void resync();
+
+    // Open a socket on ifindex for port and queue it for the dataplane;
+    // false if the port cannot be attached
+    bool attach(PortId port, std::string const& ifname, int ifindex);
+
+    // Mark port up or down; flush its FDB entries if it, or its LAG,
+    // went down
+    void setOperUp(PortId port, std::string const& ifname, bool up);
+
+private:
+    bool const                     hotAttach_;
+    int                            nlfd_ = -1;     // Link notifications
+    int                            attachFd_ = -1; // Eventfd to the dataplane
+    std::map<std::string, PortId>  ports_;         // Interface → port
+    std::vector<int>               reported_;      // Port → ifindex logged
+                                                   // as not attachable
+
+    std::mutex                     mtx_;           // Protects pending_
+    std::vector<std::pair<PortId, int>> pending_;  // Sockets to attach
+};
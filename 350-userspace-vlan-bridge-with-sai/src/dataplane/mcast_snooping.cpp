@@ -0,0 +1,279 @@
+#include "mcast_snooping.h"
+#include "switch_dataplane.h"
+
+#include <net/ethernet.h>
+#include <netinet/in.h>
+
+#include <algorithm>
+#include <cstdio>
+
+enum {
+    // IGMP message types
+    IgmpQuery    = 0x11,
+    IgmpV1Report = 0x12,
+    IgmpV2Report = 0x16,
+    IgmpLeave    = 0x17,
+    IgmpV3Report = 0x22,
+
+    // MLD message types (ICMPv6)
+    MldQuery    = 130,
+    MldV1Report = 131,
+    MldDone     = 132,
+    MldV2Report = 143,
+
+    // Group record types of IGMPv3 and MLDv2 reports
+    ModeIsInclude   = 1,
+    ModeIsExclude   = 2,
+    ChangeToInclude = 3,
+    ChangeToExclude = 4,
+    AllowNewSources = 5,
+
+    Ipv4MinHeaderLen = 20,
+    Ipv6HeaderLen    = 40,
+    Ipv4AddrLen      = 4,
+    Ipv6AddrLen      = 16,
+
+    IgmpMinLen      = 8,    // IGMPv1/v2 message
+    MldMinLen       = 24,   // MLDv1 message
+    ReportHeaderLen = 8,    // IGMPv3 / MLDv2 report up to its records
+    RecordHeaderLen = 4     // Group record up to its group address
+};
+
+// Group addresses of one IP version
+struct GroupFamily {
+    size_t     addrLen;
+    bool       (*snooped)(uint8_t const* addr);     // Registered by snooping
+    MacAddress (*mac)(uint8_t const* addr);         // Group MAC
+};
+
+static bool ipv4_group_snooped(uint8_t const* const addr)
+{
+    // Multicast, but not link local (224.0.0.x), which always floods
+    bool const multicast = (addr[0] & 0xf0) == 0xe0;
+    bool const linkLocal = addr[0] == 224 && addr[1] == 0 && addr[2] == 0;
+    return multicast && !linkLocal;
+}
+
+static MacAddress ipv4_group_mac(uint8_t const* const addr)
+{
+    // 01:00:5e and the low 23 bits of the group
+    return 0x01005e000000ULL | (uint64_t{addr[1] & 0x7fu} << 16) |
+           (uint64_t{addr[2]} << 8) | addr[3];
+}
+
+static bool ipv6_group_snooped(uint8_t const* const addr)
+{
+    // Multicast, but not all nodes (ff02::1), which always floods
+    static uint8_t const allNodes[Ipv6AddrLen] = {0xff, 0x02, 0, 0, 0, 0, 0, 0,
+                                                  0, 0, 0, 0, 0, 0, 0, 0x01};
+    return addr[0] == 0xff && !std::equal(addr, addr + Ipv6AddrLen, allNodes);
+}
+
+static MacAddress ipv6_group_mac(uint8_t const* const addr)
+{
+    // 33:33 and the low 32 bits of the group
+    return 0x333300000000ULL | (uint64_t{addr[12]} << 24) | (uint64_t{addr[13]} << 16) |
+           (uint64_t{addr[14]} << 8) | addr[15];
+}
+
+static GroupFamily const Ipv4Groups = {Ipv4AddrLen, ipv4_group_snooped, ipv4_group_mac};
+static GroupFamily const Ipv6Groups = {Ipv6AddrLen, ipv6_group_snooped, ipv6_group_mac};
+
+static uint16_t read_u16(uint8_t const* const p)
+{
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+// -----------------------------------------------------------------------------
+// Membership updates
+// -----------------------------------------------------------------------------
+
+static void join_group(VlanId const vlan, PortId const port, GroupFamily const& family,
+                       uint8_t const* const addr)
+{
+    if (!family.snooped(addr)) {
+        return;
+    }
+    MacAddress const group = family.mac(addr);
+    AgingTimer::Tick const expiry = g_aging_timer.now() + McastMembershipSecs;
+    if (g_switch_state.joinMcastGroup(vlan, group, port, expiry)) {
+        MacString const groupStr = macToString(group);
+        ::printf("[DP] mcast vlan = %d, group = %s joined at port = %d\n",
+            vlan, groupStr.data(), port);
+    }
+}
+
+static void leave_group(VlanId const vlan, PortId const port, GroupFamily const& family,
+                        uint8_t const* const addr)
+{
+    if (family.snooped(addr)) {
+        g_switch_state.leaveMcastGroup(vlan, family.mac(addr), port,
+                                       g_aging_timer.now() + McastLeaveSecs);
+    }
+}
+
+static void add_router_port(VlanId const vlan, PortId const port)
+{
+    if (g_switch_state.addMcastRouterPort(vlan, port, g_aging_timer.now() + McastRouterSecs)) {
+        ::printf("[DP] mcast vlan = %d, router port = %d\n", vlan, port);
+    }
+}
+
+// Apply the group records of an IGMPv3 or MLDv2 report of len bytes
+static void snoop_records(VlanId const vlan, PortId const port, GroupFamily const& family,
+                          uint8_t const* const msg, size_t const len)
+{
+    if (len < ReportHeaderLen) {
+        return;
+    }
+    size_t const count = read_u16(msg + 6);
+    size_t offset = ReportHeaderLen;
+    for (size_t i = 0; i < count; i++) {
+        if (len - offset < RecordHeaderLen + family.addrLen) {
+            return;
+        }
+        uint8_t const* const record = msg + offset;
+        size_t const sources = read_u16(record + 2);
+        size_t const recordLen = RecordHeaderLen + (1 + sources) * family.addrLen +
+                                 size_t{record[1]} * 4;
+        if (recordLen > len - offset) {
+            return;
+        }
+        offset += recordLen;
+
+        // A listener of any source of the group needs its frames; BLOCK
+        // records only drop sources, which L2 forwarding cannot tell apart.
+        uint8_t const* const group = record + RecordHeaderLen;
+        switch (record[0]) {
+            case ModeIsExclude:
+            case ChangeToExclude:
+                join_group(vlan, port, family, group);
+                break;
+            case ModeIsInclude:
+            case ChangeToInclude:
+                if (sources != 0) {
+                    join_group(vlan, port, family, group);
+                } else {
+                    leave_group(vlan, port, family, group);
+                }
+                break;
+            case AllowNewSources:
+                if (sources != 0) {
+                    join_group(vlan, port, family, group);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Slow path: IGMP and MLD messages
+// -----------------------------------------------------------------------------
+
+// Snoop the IGMP message of IPv4 packet ip, of len bytes
+[[gnu::cold]] static McastControl
+snoop_igmp(VlanId const vlan, PortId const port, uint8_t const* const ip, size_t len)
+{
+    size_t const ihl = size_t{ip[0] & 0x0fu} * 4;
+    len = std::min<size_t>(len, read_u16(ip + 2));
+    if ((ip[0] >> 4) != 4 || ihl < Ipv4MinHeaderLen || len < ihl + IgmpMinLen) {
+        return McastControl::None;
+    }
+    uint8_t const* const msg = ip + ihl;
+    size_t const msgLen = len - ihl;
+
+    switch (msg[0]) {
+        case IgmpQuery:
+            add_router_port(vlan, port);
+            return McastControl::Query;
+        case IgmpV1Report:
+        case IgmpV2Report:
+            join_group(vlan, port, Ipv4Groups, msg + 4);
+            return McastControl::Report;
+        case IgmpLeave:
+            leave_group(vlan, port, Ipv4Groups, msg + 4);
+            return McastControl::Report;
+        case IgmpV3Report:
+            snoop_records(vlan, port, Ipv4Groups, msg, msgLen);
+            return McastControl::Report;
+        default:
+            return McastControl::None;
+    }
+}
+
+// Snoop the MLD message of IPv6 packet ip, of len bytes, whose next header
+// is hop-by-hop options
+[[gnu::cold]] static McastControl
+snoop_mld(VlanId const vlan, PortId const port, uint8_t const* const ip, size_t len)
+{
+    len = std::min<size_t>(len, Ipv6HeaderLen + read_u16(ip + 4));
+    if (len < Ipv6HeaderLen + 2) {
+        return McastControl::None;
+    }
+    uint8_t const* const hopByHop = ip + Ipv6HeaderLen;
+    size_t const hopByHopLen = (size_t{hopByHop[1]} + 1) * 8;
+    if (hopByHop[0] != IPPROTO_ICMPV6 || len < Ipv6HeaderLen + hopByHopLen + ReportHeaderLen) {
+        return McastControl::None;
+    }
+    uint8_t const* const msg = hopByHop + hopByHopLen;
+    size_t const msgLen = len - Ipv6HeaderLen - hopByHopLen;
+
+    bool const v1 = msgLen >= MldMinLen;
+    switch (msg[0]) {
+        case MldQuery:
+            add_router_port(vlan, port);
+            return McastControl::Query;
+        case MldV1Report:
+            if (v1) {
+                join_group(vlan, port, Ipv6Groups, msg + 8);
+            }
+            return McastControl::Report;
+        case MldDone:
+            if (v1) {
+                leave_group(vlan, port, Ipv6Groups, msg + 8);
+            }
+            return McastControl::Report;
+        case MldV2Report:
+            snoop_records(vlan, port, Ipv6Groups, msg, msgLen);
+            return McastControl::Report;
+        default:
+            return McastControl::None;
+    }
+}
+
+// -----------------------------------------------------------------------------
+PortBitmap mcast_egress_ports(VlanId const vlan, PortId const port, uint8_t const* const frame,
+                              size_t const len, McastControl& outControl)
+{
+    outControl = McastControl::None;
+    if (g_switch_state.numPorts() > PortBitmapMaxPorts) {
+        return AllPortsBitmap;
+    }
+
+    // Payload behind up to two VLAN tags
+    size_t const offset = payload_offset(frame, len);
+    uint16_t const type = extract_ethertype(frame + offset - 2);
+    uint8_t const* const p = frame + offset;
+    size_t const l3Len = len - offset;
+
+    // Punt membership messages only; everything else is data.
+    if (type == ETH_P_IP && l3Len >= Ipv4MinHeaderLen && p[9] == IPPROTO_IGMP) {
+        outControl = snoop_igmp(vlan, port, p, l3Len);
+    } else if (type == ETH_P_IPV6 && l3Len >= Ipv6HeaderLen && p[6] == IPPROTO_HOPOPTS) {
+        outControl = snoop_mld(vlan, port, p, l3Len);
+    }
+
+    switch (outControl) {
+        case McastControl::Query:
+            return AllPortsBitmap;
+        case McastControl::Report:
+            return g_switch_state.mcastRouterPorts(vlan);
+        case McastControl::None:
+            break;
+    }
+
+    PortBitmap ports = 0;
+    return g_switch_state.lookupMcastGroup(vlan, extract_mac(frame), ports) ? ports : AllPortsBitmap;
+}
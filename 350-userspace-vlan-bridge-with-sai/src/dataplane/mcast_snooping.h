@@ -0,0 +1,54 @@
+#pragma once
+
+#include "switch_state.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// IGMP and MLD snooping.
+//
+// The dataplane hands each multicast frame to mcast_egress_ports(), which
+// picks out the membership messages with a check of the IP protocol (IGMP)
+// or next header (hop-by-hop options, which MLD messages start with), and
+// only punts those to the snooping slow path:
+//
+//  - IGMP / MLD queries make the ingress port a multicast router port of
+//    the VLAN, and flood
+//  - IGMPv1/v2 reports and MLDv1 reports add the ingress port to the
+//    group; IGMPv3 and MLDv2 reports do so for records that ask for
+//    sources of the group, and let it go for records that ask for none
+//  - IGMPv2 leaves and MLD dones let the membership expire shortly,
+//    unless a report renews it
+//  - reports and leaves only go to the router ports, so that hosts do not
+//    suppress their own reports on hearing another's
+//
+// Data frames to a registered group go to its listeners and the router
+// ports; frames to unregistered groups flood, as do the link-local groups
+// 224.0.0.x and ff02::1, which are never registered. Groups are tracked by
+// MAC, so IPv4 groups that share a MAC (32 per MAC) share their listeners.
+// Memberships and router ports expire on g_aging_timer.
+// -----------------------------------------------------------------------------
+
+enum {
+    // Group membership interval and other querier present interval, in
+    // seconds: robustness 2 x query interval 125 s + response time 10 s
+    McastMembershipSecs = 260,
+    McastRouterSecs = 260,
+
+    // Time a membership stays after a leave, for a report to renew it
+    McastLeaveSecs = 2
+};
+
+// Kind of a multicast frame, as far as snooping is concerned
+enum class McastControl : uint8_t {
+    None,       // Data, or a message that is not snooped
+    Query,      // Membership query
+    Report      // Membership report, leave, or done
+};
+
+// Egress ports of a multicast frame of len bytes received on port and
+// classified into vlan, as a bitmap to intersect with its flood set:
+// AllPortsBitmap if it floods. outControl receives the kind of frame.
+PortBitmap mcast_egress_ports(VlanId vlan, PortId port, uint8_t const* frame, size_t len,
+                              McastControl& outControl);
@@ -0,0 +1,181 @@
+#include "netlink_link.h"
+
+#include <linux/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+enum {
+    NetlinkRecvBufSize = 32 * 1024
+};
+
+bool LinkInfo::operUp() const
+{
+    // Links without operstate support (IF_OPER_UNKNOWN) go by IFF_RUNNING.
+    if (!(flags & IFF_UP))
+        return false;
+    if (operstate == IF_OPER_UNKNOWN)
+        return (flags & IFF_RUNNING) != 0;
+    return operstate == IF_OPER_UP;
+}
+
+// Object of type T at offset bytes into base. Netlink messages are walked
+// with this instead of the NLMSG_*/RTA_* macros, which use C casts.
+template <typename T>
+static T const* at(void const* const base, size_t const offset)
+{
+    return reinterpret_cast<T const*>(static_cast<uint8_t const*>(base) + offset);
+}
+
+// Parse the interface name and link of an RTM_NEWLINK/RTM_DELLINK message
+static bool
+parse_link(nlmsghdr const* nh, std::string& outName, LinkInfo& outLink)
+{
+    size_t const ifiOffset = NLMSG_ALIGN(sizeof(nlmsghdr));
+    if (nh->nlmsg_len < ifiOffset + sizeof(ifinfomsg))
+        return false;
+
+    auto const* ifi = at<ifinfomsg>(nh, ifiOffset);
+    outLink.ifindex = ifi->ifi_index;
+    outLink.flags = ifi->ifi_flags;
+
+    outName.clear();
+    size_t offset = ifiOffset + NLMSG_ALIGN(sizeof(ifinfomsg));
+    while (offset + sizeof(rtattr) <= nh->nlmsg_len) {
+        auto const* rta = at<rtattr>(nh, offset);
+        if (rta->rta_len < sizeof(rtattr) || offset + rta->rta_len > nh->nlmsg_len)
+            break;
+
+        size_t const dataLen = rta->rta_len - RTA_ALIGN(sizeof(rtattr));
+        auto const* data = at<char>(rta, RTA_ALIGN(sizeof(rtattr)));
+        if (rta->rta_type == IFLA_IFNAME) {
+            outName.assign(data, strnlen(data, dataLen));
+        } else if (rta->rta_type == IFLA_OPERSTATE && dataLen >= 1) {
+            outLink.operstate = static_cast<uint8_t>(*data);
+        }
+        offset += RTA_ALIGN(rta->rta_len);
+    }
+    return !outName.empty();
+}
+
+bool netlink_dump_links(LinkTable& outLinks)
+{
+    int const fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        perror("socket(NETLINK_ROUTE)");
+        return false;
+    }
+
+    struct {
+        nlmsghdr  nh;
+        ifinfomsg ifi;
+    } req = {};
+    req.nh.nlmsg_len = sizeof(req);
+    req.nh.nlmsg_type = RTM_GETLINK;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq = 1;
+    req.ifi.ifi_family = AF_UNSPEC;
+
+    if (send(fd, &req, sizeof(req), 0) < 0) {
+        perror("send(RTM_GETLINK)");
+        close(fd);
+        return false;
+    }
+
+    outLinks.clear();
+    std::vector<uint8_t> buf(NetlinkRecvBufSize);
+    bool done = false;
+    bool ok = true;
+    while (!done && ok) {
+        ssize_t const n = recv(fd, buf.data(), buf.size(), 0);
+        if (n < 0) {
+            perror("recv(RTM_GETLINK)");
+            ok = false;
+            break;
+        }
+
+        size_t offset = 0;
+        while (offset + sizeof(nlmsghdr) <= static_cast<size_t>(n)) {
+            auto const* nh = at<nlmsghdr>(buf.data(), offset);
+            if (nh->nlmsg_len < sizeof(nlmsghdr) || offset + nh->nlmsg_len > static_cast<size_t>(n))
+                break;
+            offset += NLMSG_ALIGN(nh->nlmsg_len);
+
+            if (nh->nlmsg_type == NLMSG_DONE) {
+                done = true;
+                break;
+            }
+            if (nh->nlmsg_type == NLMSG_ERROR) {
+                ok = false;
+                break;
+            }
+            if (nh->nlmsg_type != RTM_NEWLINK)
+                continue;
+
+            std::string name;
+            LinkInfo link;
+            if (parse_link(nh, name, link)) {
+                outLinks[name] = link;
+            }
+        }
+    }
+
+    close(fd);
+    return ok;
+}
+
+int netlink_open_link_events()
+{
+    int const fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        perror("socket(NETLINK_ROUTE)");
+        return -1;
+    }
+
+    sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror("bind(RTMGRP_LINK)");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool netlink_read_link_events(int const fd, LinkEventFn const& fn)
+{
+    std::vector<uint8_t> buf(NetlinkRecvBufSize);
+    ssize_t const n = recv(fd, buf.data(), buf.size(), 0);
+    if (n < 0) {
+        if (errno == ENOBUFS)
+            return false;
+        if (errno != EINTR)
+            perror("recv(RTMGRP_LINK)");
+        return true;
+    }
+
+    size_t offset = 0;
+    while (offset + sizeof(nlmsghdr) <= static_cast<size_t>(n)) {
+        auto const* nh = at<nlmsghdr>(buf.data(), offset);
+        if (nh->nlmsg_len < sizeof(nlmsghdr) || offset + nh->nlmsg_len > static_cast<size_t>(n))
+            break;
+        offset += NLMSG_ALIGN(nh->nlmsg_len);
+
+        if (nh->nlmsg_type != RTM_NEWLINK && nh->nlmsg_type != RTM_DELLINK)
+            continue;
+
+        std::string name;
+        LinkInfo link;
+        if (parse_link(nh, name, link)) {
+            fn(name, link, nh->nlmsg_type == RTM_DELLINK);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+// -----------------------------------------------------------------------------
+// Link information from rtnetlink (RTM_GETLINK / RTM_NEWLINK)
+// -----------------------------------------------------------------------------
+struct LinkInfo {
+    int      ifindex   = 0;
+    uint32_t flags     = 0;   // IFF_* flags
+    uint8_t  operstate = 0;   // IF_OPER_*
+
+    // Administratively up and carrier present
+    bool operUp() const;
+};
+
+// Interface name → link
+typedef std::map<std::string, LinkInfo> LinkTable;
+
+// Fetch all links of the network namespace with one RTM_GETLINK dump;
+// return false on a netlink error
+bool netlink_dump_links(LinkTable& outLinks);
+
+// Link change notification: interface name, link, and whether the link
+// was deleted (RTM_DELLINK) rather than added or changed (RTM_NEWLINK)
+typedef std::function<void(std::string const&, LinkInfo const&, bool)> LinkEventFn;
+
+// Open a blocking netlink socket subscribed to link changes
+// (RTNLGRP_LINK); -1 on failure
+int netlink_open_link_events();
+
+// Receive one batch of link changes from fd and call fn for each; return
+// false if the socket overran (ENOBUFS) and notifications were lost
+bool netlink_read_link_events(int fd, LinkEventFn const& fn);
@@ -0,0 +1,120 @@
+#include "packet_pool.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+enum {
+    HugePageSize = 2 * 1024 * 1024,
+
+    // Leaked buffers listed by checkLeaks()
+    MaxLeaksReported = 8
+};
+
+// -----------------------------------------------------------------------------
+PacketPool::Cache::~Cache()
+{
+    std::lock_guard<std::mutex> lock(pool_.mtx_);
+    pool_.free_.insert(pool_.free_.end(), bufs_.begin(), bufs_.begin() + count_);
+    count_ = 0;
+}
+
+// -----------------------------------------------------------------------------
+PacketPool::PacketPool(uint32_t const numBufs) : numBufs_{numBufs}
+{
+    size_t const len = size_t{numBufs_} * SlotSize;
+    memLen_ = (len + HugePageSize - 1) / HugePageSize * HugePageSize;
+
+    // Prefer reserved hugepages; otherwise ask for transparent hugepages.
+    void* mem = mmap(nullptr, memLen_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    hugepages_ = (mem != MAP_FAILED);
+    if (!hugepages_) {
+        mem = mmap(nullptr, memLen_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (mem == MAP_FAILED) {
+            perror("mmap");
+            exit(1);
+        }
+        madvise(mem, memLen_, MADV_HUGEPAGE);
+    }
+    mem_ = static_cast<uint8_t*>(mem);
+
+    free_.reserve(numBufs_);
+    for (uint32_t i = numBufs_; i > 0; i--) {
+        PacketBuf* const buf = new (slot(i - 1)) PacketBuf;
+        buf->index = i - 1;
+        free_.push_back(buf);
+    }
+}
+
+PacketPool::~PacketPool()
+{
+    checkLeaks(0);
+    munmap(mem_, memLen_);
+}
+
+bool PacketPool::refill(Cache& cache)
+{
+    assert(&cache.pool_ == this);
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    size_t const n = std::min<size_t>(CacheBatch, free_.size());
+    for (size_t i = 0; i < n; i++) {
+        cache.bufs_[cache.count_++] = free_.back();
+        free_.pop_back();
+    }
+    return n != 0;
+}
+
+void PacketPool::spill(Cache& cache)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (size_t i = 0; i < CacheBatch; i++) {
+        free_.push_back(cache.bufs_[--cache.count_]);
+    }
+}
+
+size_t PacketPool::checkLeaks(size_t const expectedInUse) const
+{
+#ifdef NDEBUG
+    return expectedInUse;
+#else
+    size_t inUse = 0;
+    for (uint32_t i = 0; i < numBufs_; i++) {
+        if (slot(i)->refcnt.load(std::memory_order_acquire) != 0) {
+            inUse++;
+        }
+    }
+    if (inUse <= expectedInUse) {
+        return inUse;
+    }
+
+    ::printf("[DP] packet pool: %zu buffers in use, expected %zu\n", inUse, expectedInUse);
+    size_t reported = 0;
+    for (uint32_t i = 0; i < numBufs_ && reported < MaxLeaksReported; i++) {
+        PacketBuf const* const buf = slot(i);
+        uint32_t const refcnt = buf->refcnt.load(std::memory_order_acquire);
+        if (refcnt != 0) {
+            ::printf("  buf %u: refcnt=%u port=%u len=%u alloc#%" PRIu64 "\n",
+                buf->index, refcnt, buf->port, buf->len, buf->allocSeq);
+            reported++;
+        }
+    }
+    return inUse;
+#endif
+}
+
+std::string PacketPool::tostring() const
+{
+    char buf[128];
+    int const n = std::snprintf(buf, sizeof(buf),
+        "pool: bufs=%u slot=%u hugepages=%s exhausted=%" PRIu64 "\n",
+        numBufs_, static_cast<unsigned>(SlotSize),
+        hugepages_ ? "yes" : "no", exhausted());
+    return (n > 0) ? std::string(buf, static_cast<size_t>(n)) : std::string{};
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include "switch_state.h"
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum {
+    // Free bytes in front of a received frame, for pushing VLAN tags
+    PacketHeadroom = 128,
+
+    // Buffers of the dataplane pool at least; it grows with the port count
+    // (see run_dataplane())
+    PacketPoolSize = 8192
+};
+
+// -----------------------------------------------------------------------------
+// PacketBuf: one fixed-size buffer of a PacketPool. The metadata sits at the
+// start of the slot, followed by the headroom and then the frame data.
+//
+// A buffer is reference counted, so that a flooded frame can be queued to
+// several egress ports without copying; it returns to the pool when the
+// last reference is released.
+//
+// A VLAN tag is pushed into the headroom or popped in place: only the
+// 12 bytes of MAC addresses move, never the payload. Only the outer tag is
+// handled; on provider ports that is the 802.1ad S-tag, and a customer
+// tag behind it stays payload.
+// -----------------------------------------------------------------------------
+struct alignas(64) PacketBuf {
+    uint8_t*              data = nullptr;  // Frame start
+    uint16_t              len = 0;         // Frame length
+    bool                  vlanTagged = false;  // Outer tag has the port's TPID
+    PortId                port = 0;        // Ingress port
+    std::atomic<uint32_t> refcnt{0};
+    uint32_t              index = 0;       // Slot in the pool
+    uint64_t              allocSeq = 0;    // Allocation number in its Cache, for leak reports
+
+    // Start of the headroom
+    uint8_t* base() { return reinterpret_cast<uint8_t*>(this) + sizeof(PacketBuf); }
+
+    size_t headroom() const
+    {
+        return static_cast<size_t>(data - reinterpret_cast<uint8_t const*>(this) - sizeof(PacketBuf));
+    }
+
+    // Grow the frame by n bytes at the front; return the new start
+    uint8_t* prepend(size_t const n)
+    {
+        assert(n <= headroom());
+        data -= n;
+        len = static_cast<uint16_t>(len + n);
+        return data;
+    }
+
+    // Remove n bytes from the front of the frame; return the new start
+    uint8_t* adj(size_t const n)
+    {
+        assert(n <= len);
+        data += n;
+        len = static_cast<uint16_t>(len - n);
+        return data;
+    }
+
+    // TCI of the frame's VLAN tag; only valid if vlanTagged
+    uint16_t vlanTci() const
+    {
+        return static_cast<uint16_t>(data[2 * MacAddressByteLen + 2] << 8 |
+                                     data[2 * MacAddressByteLen + 3]);
+    }
+
+    // TPID and TCI of the frame's VLAN tag, as one word
+    uint32_t vlanTag() const
+    {
+        uint32_t tag;
+        std::memcpy(&tag, data + 2 * MacAddressByteLen, sizeof(tag));
+        return __builtin_bswap32(tag);
+    }
+
+    // Insert a VLAN tag of tpid with tci after the MAC addresses
+    void pushVlanTag(uint16_t const tpid, uint16_t const tci)
+    {
+        uint8_t* const p = prepend(VlanTagByteLen);
+        std::memmove(p, p + VlanTagByteLen, 2 * MacAddressByteLen);
+        p[2 * MacAddressByteLen]     = static_cast<uint8_t>(tpid >> 8);
+        p[2 * MacAddressByteLen + 1] = static_cast<uint8_t>(tpid);
+        p[2 * MacAddressByteLen + 2] = static_cast<uint8_t>(tci >> 8);
+        p[2 * MacAddressByteLen + 3] = static_cast<uint8_t>(tci);
+        vlanTagged = true;
+    }
+
+    // Remove the VLAN tag
+    void popVlanTag()
+    {
+        assert(vlanTagged);
+        std::memmove(data + VlanTagByteLen, data, 2 * MacAddressByteLen);
+        adj(VlanTagByteLen);
+        vlanTagged = false;
+    }
+
+    // True if the frame leaves as is for an egress port that wants a tag
+    // of tpid with tci, or no tag if tci is 0
+    bool hasVlanTag(uint16_t const tpid, uint16_t const tci) const
+    {
+        return tci == 0 ? !vlanTagged
+                        : (vlanTagged && vlanTag() == (uint32_t{tpid} << 16 | tci));
+    }
+
+    // Tag the frame with tpid and tci, or untag it if tci is 0. Frames that
+    // already have the wanted tag are not written to.
+    void setVlanTag(uint16_t const tpid, uint16_t const tci)
+    {
+        if (hasVlanTag(tpid, tci)) {
+            return;
+        }
+        if (vlanTagged) {
+            popVlanTag();
+        }
+        if (tci != 0) {
+            pushVlanTag(tpid, tci);
+        }
+    }
+
+    // TCI for sending the frame tagged in vlan: the VID of vlan, with the
+    // priority of the frame's own tag, if any
+    uint16_t egressTci(VlanId const vlan) const
+    {
+        uint16_t const pcpDei = vlanTagged ? (vlanTci() & VlanPcpDeiMask) : 0;
+        return static_cast<uint16_t>(pcpDei | vlan);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// PacketPool: preallocated packet buffers.
+//
+// All buffers are carved out of one mapping, backed by hugepages when the
+// system has them reserved, and touched at creation so the dataplane never
+// page faults on them. Each thread allocates and releases through its own
+// Cache, which refills from and spills to the shared free list in batches,
+// so the pool lock is taken once per CacheBatch buffers.
+//
+// Exhaustion is counted. In debug builds, checkLeaks() reports buffers
+// still referenced when their owner expects none.
+// -----------------------------------------------------------------------------
+class PacketPool {
+public:
+    enum {
+        SlotSize   = sizeof(PacketBuf) + PacketHeadroom + MaxFrameByteLen,
+        CacheSize  = 64,   // Buffers a Cache holds at most
+        CacheBatch = 32    // Buffers moved between a Cache and the pool at once
+    };
+
+    static_assert(SlotSize % alignof(PacketBuf) == 0, "slots must stay aligned");
+
+    // Per-thread buffer cache; not thread safe, use one per thread
+    class Cache {
+    public:
+        explicit Cache(PacketPool& pool) : pool_{pool} {}
+
+        // Returns the cached buffers to the pool
+        ~Cache();
+
+        Cache(Cache const&) = delete;
+        Cache& operator=(Cache const&) = delete;
+
+    private:
+        friend class PacketPool;
+
+        PacketPool&                        pool_;
+        std::array<PacketBuf*, CacheSize>  bufs_;
+        uint32_t                           count_ = 0;
+        uint64_t                           allocs_ = 0;  // Successful allocations
+    };
+
+    explicit PacketPool(uint32_t numBufs);
+    ~PacketPool();
+
+    PacketPool(PacketPool const&) = delete;
+    PacketPool& operator=(PacketPool const&) = delete;
+
+    // Allocate a buffer with one reference and an empty frame after the
+    // headroom; return nullptr if the pool is exhausted
+    PacketBuf* alloc(Cache& cache)
+    {
+        if (cache.count_ == 0 && !refill(cache)) {
+            exhausted_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        PacketBuf* const buf = cache.bufs_[--cache.count_];
+        assert(buf->refcnt.load(std::memory_order_relaxed) == 0);
+        buf->refcnt.store(1, std::memory_order_relaxed);
+        buf->data = buf->base() + PacketHeadroom;
+        buf->len = 0;
+        buf->vlanTagged = false;
+        buf->allocSeq = cache.allocs_++;
+        return buf;
+    }
+
+    // Allocate a buffer holding a copy of the frame of buf, at the same
+    // headroom; return nullptr if the pool is exhausted
+    PacketBuf* clone(Cache& cache, PacketBuf const& buf)
+    {
+        PacketBuf* const copy = alloc(cache);
+        if (copy) {
+            copy->data = copy->base() + buf.headroom();
+            std::memcpy(copy->data, buf.data, buf.len);
+            copy->len = buf.len;
+            copy->vlanTagged = buf.vlanTagged;
+            copy->port = buf.port;
+        }
+        return copy;
+    }
+
+    // Add n references to buf
+    static void ref(PacketBuf* const buf, uint32_t const n = 1)
+    {
+        buf->refcnt.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // Drop one reference to buf; the last one returns it to the pool
+    void release(Cache& cache, PacketBuf* const buf)
+    {
+        uint32_t const prev = buf->refcnt.fetch_sub(1, std::memory_order_acq_rel);
+        assert(prev != 0);
+        if (prev != 1) {
+            return;
+        }
+        if (cache.count_ == CacheSize) {
+            spill(cache);
+        }
+        cache.bufs_[cache.count_++] = buf;
+    }
+
+    uint32_t size() const { return numBufs_; }
+
+    bool hugepages() const { return hugepages_; }
+
+    // Failed allocations
+    uint64_t exhausted() const { return exhausted_.load(std::memory_order_relaxed); }
+
+    // Report buffers in use beyond expectedInUse; return the number in use.
+    // Walks the whole pool, so only call it when idle. No-op (returns
+    // expectedInUse) unless this is a debug build.
+    size_t checkLeaks(size_t expectedInUse) const;
+
+    // String representation of the pool counters
+    std::string tostring() const;
+
+private:
+    PacketBuf* slot(uint32_t const i) const
+    {
+        return reinterpret_cast<PacketBuf*>(mem_ + size_t{i} * SlotSize);
+    }
+
+    // Move CacheBatch buffers from the free list into cache; false if none
+    bool refill(Cache& cache);
+
+    // Move CacheBatch buffers from cache to the free list
+    void spill(Cache& cache);
+
+private:
+    uint32_t const           numBufs_;
+    uint8_t*                 mem_ = nullptr;
+    size_t                   memLen_ = 0;
+    bool                     hugepages_ = false;
+
+    std::mutex               mtx_;
+    std::vector<PacketBuf*>  free_;       // Guarded by mtx_
+
+    std::atomic<uint64_t>    exhausted_{0};
+};
@@ -0,0 +1,414 @@
+#pragma once
+
+#include "switch_dataplane.h"
+#include "switch_state.h"
+#include "packet_pool.h"
+#include "arp_suppression.h"
+#include "mcast_snooping.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+// -----------------------------------------------------------------------------
+// Frame pipeline composed at compile time.
+//
+// Each stage is a policy class with a static
+//
+//     template <typename Core>
+//     static bool process(Core& core, FrameContext& ctx);
+//
+// that returns false to stop processing the frame. A Pipeline<Stages...>
+// runs its stages in order; there is no runtime feature check, so a stage
+// that is left out of a pipeline costs nothing.
+//
+// The core provides the port-count specific parts, i.e. counters, storm
+// control buckets, and sending the frame to a port or a flood set. It owns
+// the frame buffer for the duration of process(). Policies such as storm
+// control, ARP / ND suppression and multicast snooping are stages of their
+// own, so a flavour leaves them out by leaving out the stage; FDB aging is
+// a policy of the learn stage (see FdbAging).
+//
+// Frames keep their VLAN tag, if any, through the pipeline; each egress
+// port gets the frame with the tag of its VLAN membership and TPID, see
+// TransmitStage. Lookup and flood sets give LAG ports, which TransmitStage
+// resolves to a member by the frame's flow hash. Multicast frames flood to
+// the part of the flood set that IGMP / MLD snooping allows (see
+// McastSnoopStage and mcast_snooping.h). ARP / ND requests for a bound
+// target are looked up under the owner's MAC instead of flooding (see
+// NeighSuppressStage and arp_suppression.h).
+// -----------------------------------------------------------------------------
+
+// Per-frame state handed from stage to stage
+struct FrameContext {
+    PacketBuf*       pkt = nullptr;    // Frame; owned by the core
+    PortId           port = 0;         // Ingress port
+
+    MacAddress       dmac = 0;         // Parse
+    MacAddress       smac = 0;
+    uint16_t         ethtype = 0;
+
+    MacClass         dmacClass = MacClass::Unicast;
+
+    VlanId           vlan = DefaultVlanId;           // Classify
+    uint16_t         tci = 0;                        // TCI for tagged egress
+    LearnMode        learn = LearnMode::Hardware;    // Source MAC learning
+
+    bool             learnedOrMoved = false;         // Learn
+
+    bool             found = false;                  // NeighSuppress, Lookup
+    PortId           out = 0;                        // Port or LAG port
+    bool             outTagged = false;              // Frame leaves out tagged
+    PortBitmap       mcastPorts = AllPortsBitmap;    // McastSnoop: egress ports
+
+    VlanFloodSetsPtr floodSets;                      // Replicate; null for unicast
+
+    bool             hashed = false;                 // Transmit, to a LAG
+    uint32_t         flowHash = 0;
+};
+
+// True if the lookup found the egress port of the frame, other than the
+// port (or LAG) it came in on; all other frames flood
+inline bool forwards_unicast(FrameContext const& ctx)
+{
+    return ctx.found && ctx.out != g_switch_state.lagPort(ctx.port);
+}
+
+// -----------------------------------------------------------------------------
+// Log policies
+// -----------------------------------------------------------------------------
+
+// Log every frame and FDB change to the console
+struct VerboseLog {
+    static void rx(FrameContext const& ctx)
+    {
+        logPacket("\n", "Rx", ctx.port, ctx.dmac, ctx.smac, ctx.ethtype);
+    }
+
+    static void tx(FrameContext const& ctx, PortId const port)
+    {
+        logPacket("  ", "Tx", port, ctx.dmac, ctx.smac, ctx.ethtype);
+    }
+
+    static void learn(FrameContext const& ctx)
+    {
+        logLearn(ctx.vlan, ctx.smac, ctx.port);
+    }
+
+    static void fdb()
+    {
+        auto const fdbString = g_switch_state.tostringFdb();
+        std::cout << "== Current FDB ==\n";
+        std::cout << fdbString << std::endl;
+    }
+};
+
+// Log nothing
+struct QuietLog {
+    static void rx(FrameContext const&) {}
+    static void tx(FrameContext const&, PortId) {}
+    static void learn(FrameContext const&) {}
+    static void fdb() {}
+};
+
+// -----------------------------------------------------------------------------
+// FDB aging policies
+// -----------------------------------------------------------------------------
+
+// Stamp learned entries with the current time, so that they age out after
+// the FDB aging time
+struct FdbAging {
+    static AgingTimer::Tick stamp() { return g_aging_timer.now(); }
+};
+
+// Learned entries never age out
+struct NoFdbAging {
+    static AgingTimer::Tick stamp() { return AgingTimer::Never; }
+};
+
+// -----------------------------------------------------------------------------
+// Stages
+// -----------------------------------------------------------------------------
+
+// Placeholder for a disabled stage
+struct NullStage {
+    template <typename Core>
+    static bool process(Core&, FrameContext&)
+    {
+        return true;
+    }
+};
+
+// Extract the Ethernet header and classify the dmac
+template <typename Log>
+struct ParseStage {
+    template <typename Core>
+    static bool process(Core& core, FrameContext& ctx)
+    {
+        uint8_t const* const frame = ctx.pkt->data;
+        ctx.dmac = extract_mac(frame);
+        ctx.smac = extract_mac(frame + MacAddressByteLen);
+        ctx.ethtype = extract_payload_ethertype(frame);
+
+        ctx.dmacClass = classify_mac(ctx.dmac);
+        core.stats().countRx(ctx.dmacClass);
+        core.portStats(ctx.port).rxFrames++;
+
+        Log::rx(ctx);
+        return true;
+    }
+};
+
+// Classify the frame into a VLAN, by its VLAN tag or the PVID of the
+// ingress port; drop tagged frames of VLANs the port is not a member of
+struct ClassifyStage {
+    template <typename Core>
+    static bool process(Core& core, FrameContext& ctx)
+    {
+        PacketBuf const& pkt = *ctx.pkt;
+        VlanId const vid = pkt.vlanTagged ? (pkt.vlanTci() & VlanIdMask) : 0;
+        if (!g_switch_state.classifyVlan(ctx.port, pkt.vlanTagged, vid, ctx.vlan, ctx.learn)) {
+            core.stats().vlanDrops++;
+            return false;
+        }
+        ctx.tci = pkt.egressTci(ctx.vlan);
+        return true;
+    }
+};
+
+// Learn the source MAC, unless the learning mode of the port and VLAN says
+// otherwise; Aging stamps the entry
+template <typename Log, typename Aging>
+struct LearnStage {
+    template <typename Core>
+    static bool process(Core&, FrameContext& ctx)
+    {
+        if (ctx.learn != LearnMode::Hardware) {
+            reportUnlearned(ctx.vlan, ctx.smac, ctx.port, ctx.learn);
+            return true;
+        }
+        auto const [learned, moved] = g_switch_state.learnMac(ctx.vlan, ctx.smac, ctx.port,
+                                                              Aging::stamp());
+        ctx.learnedOrMoved = learned || moved;
+        if (ctx.learnedOrMoved) {
+            Log::learn(ctx);
+        }
+        return true;
+    }
+};
+
+// Snoop ARP / ND messages; a request for a bound target goes to its owner
+// like a unicast frame to the owner's MAC, instead of flooding
+struct NeighSuppressStage {
+    template <typename Core>
+    static bool process(Core& core, FrameContext& ctx)
+    {
+        if (!is_arp_nd_ethertype(ctx.ethtype)) {
+            return true;
+        }
+        MacAddress owner = 0;
+        switch (arp_nd_snoop(ctx.vlan, ctx.learn, ctx.ethtype, ctx.pkt->data, ctx.pkt->len,
+                             owner)) {
+            case NeighLookup::Hit:
+                core.stats().neighHits++;
+                ctx.found = g_switch_state.lookupFdb(ctx.vlan, owner, ctx.out, &ctx.outTagged);
+                break;
+            case NeighLookup::Miss:
+                core.stats().neighMisses++;
+                break;
+            case NeighLookup::None:
+                break;
+        }
+        return true;
+    }
+};
+
+// Limit multicast frames to the ports IGMP / MLD snooping allows; the
+// membership messages among them are punted to snooping here
+struct McastSnoopStage {
+    template <typename Core>
+    static bool process(Core& core, FrameContext& ctx)
+    {
+        if (!ctx.found && ctx.dmacClass == MacClass::Multicast) {
+            McastControl control;
+            ctx.mcastPorts = mcast_egress_ports(ctx.vlan, ctx.port, ctx.pkt->data,
+                                                ctx.pkt->len, control);
+            if (control != McastControl::None) {
+                core.stats().mcastSnooped++;
+            }
+        }
+        return true;
+    }
+};
+
+// Look up the destination MAC, unless an earlier stage found the egress
+// port already
+struct LookupStage {
+    template <typename Core>
+    static bool process(Core&, FrameContext& ctx)
+    {
+        // Group addresses go straight to flooding, only unicast
+        // destination MACs are looked up in FDB.
+        if (!ctx.found && ctx.dmacClass == MacClass::Unicast) {
+            ctx.found = g_switch_state.lookupFdb(ctx.vlan, ctx.dmac, ctx.out, &ctx.outTagged);
+        }
+        return true;
+    }
+};
+
+// Drop floods over the storm control limit of the ingress port
+struct StormControlStage {
+    template <typename Core>
+    static bool process(Core& core, FrameContext& ctx)
+    {
+        if (forwards_unicast(ctx) ||
+            core.stormControl().admit(ctx.port, ctx.dmacClass, ctx.pkt->len)) {
+            return true;
+        }
+        core.portStats(ctx.port).countStormDrop(ctx.dmacClass);
+        return false;
+    }
+};
+
+// Choose between unicast forwarding and flooding
+struct ReplicateStage {
+    template <typename Core>
+    static bool process(Core& core, FrameContext& ctx)
+    {
+        if (forwards_unicast(ctx)) {
+            core.stats().fwdUnicast++;
+            return true;
+        }
+
+        if (ctx.dmacClass == MacClass::Unicast) {
+            core.stats().floodUnknown++;
+        } else if (ctx.mcastPorts != AllPortsBitmap) {
+            core.stats().fwdMulticast++;
+        } else {
+            core.stats().floodGroup++;
+        }
+
+        // Flood inside VLAN using the precomputed egress set
+        // of this ingress port; without VLAN config it covers
+        // ALL ports except ingress port
+        ctx.floodSets = g_switch_state.getFloodSets(ctx.vlan);
+        return true;
+    }
+};
+
+// Send the frame to the egress port(s), tagged or untagged per port; a LAG
+// port sends through the member its flow hash maps to
+template <typename Log>
+struct TransmitStage {
+    template <typename Core>
+    static bool process(Core& core, FrameContext& ctx)
+    {
+        if (!ctx.floodSets) {
+            PortId const out = member(ctx, ctx.out);
+            core.transmit(out, *ctx.pkt, ctx.outTagged ? ctx.tci : 0);
+            Log::tx(ctx, out);
+        } else {
+            // The ports that take the frame with its current tagging go
+            // first, so that its tag changes at most once.
+            FloodSet const& floodSet = (*ctx.floodSets)[ctx.port];
+            if (ctx.pkt->vlanTagged) {
+                flood(core, ctx, floodSet.tagged, ctx.tci);
+                flood(core, ctx, floodSet.untagged, 0);
+            } else {
+                flood(core, ctx, floodSet.untagged, 0);
+                flood(core, ctx, floodSet.tagged, ctx.tci);
+            }
+        }
+
+        if (ctx.learnedOrMoved) {
+            Log::fdb();
+        }
+        return true;
+    }
+
+    // Send the frame to the ports of egress that snooping allows, with tag
+    // tci (untagged if 0)
+    template <typename Core>
+    static void flood(Core& core, FrameContext& ctx, EgressPorts const& egress,
+                      uint16_t const tci)
+    {
+        core.forEachPort(egress, [&](PortId const p) {
+            if (!bitmap_has_port(ctx.mcastPorts, p)) {
+                return;
+            }
+            PortId const out = member(ctx, p);
+            core.transmit(out, *ctx.pkt, tci);
+            Log::tx(ctx, out);
+        });
+    }
+
+    // Port to send to for egress port p: the LAG member of the frame's
+    // flow if p is a LAG port; the hash is computed once per frame
+    static PortId member(FrameContext& ctx, PortId const p)
+    {
+        if (!g_switch_state.isLag(p)) {
+            return p;
+        }
+        if (!ctx.hashed) {
+            ctx.flowHash = flow_hash(ctx.pkt->data, ctx.pkt->len);
+            ctx.hashed = true;
+        }
+        return g_switch_state.lagMember(p, ctx.flowHash);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Pipeline: runs Stages in order until one of them returns false
+// -----------------------------------------------------------------------------
+template <typename... Stages>
+struct Pipeline {
+    template <typename Core>
+    static void process(Core& core, FrameContext& ctx)
+    {
+        (Stages::process(core, ctx) && ...);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Prebuilt pipeline flavours, one per build target
+// -----------------------------------------------------------------------------
+
+// Learning switch that logs every frame (userspace_switch)
+typedef Pipeline<
+    ParseStage<VerboseLog>,
+    ClassifyStage,
+    LearnStage<VerboseLog, FdbAging>,
+    NeighSuppressStage,
+    McastSnoopStage,
+    LookupStage,
+    StormControlStage,
+    ReplicateStage,
+    TransmitStage<VerboseLog>
+> StandardPipeline;
+
+// Learning switch without per-frame logging (userspace_switch_quiet)
+typedef Pipeline<
+    ParseStage<QuietLog>,
+    ClassifyStage,
+    LearnStage<QuietLog, FdbAging>,
+    NeighSuppressStage,
+    McastSnoopStage,
+    LookupStage,
+    StormControlStage,
+    ReplicateStage,
+    TransmitStage<QuietLog>
+> QuietPipeline;
+
+// No learning, no ARP / ND suppression, no snooping, no lookup and no storm
+// control; floods every frame inside its VLAN (userspace_switch_hub)
+typedef Pipeline<
+    ParseStage<VerboseLog>,
+    ClassifyStage,
+    NullStage,
+    NullStage,
+    NullStage,
+    NullStage,
+    NullStage,
+    ReplicateStage,
+    TransmitStage<VerboseLog>
+> HubPipeline;
@@ -0,0 +1,500 @@
+#pragma once
+
+#include "switch_dataplane.h"
+#include "switch_state.h"
+#include "dataplane_stats.h"
+#include "ingress_scheduler.h"
+#include "packet_pool.h"
+#include "pipeline.h"
+#include "spsc_ring.h"
+#include "storm_control.h"
+#include "tx_queue.h"
+#include "cycles.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// PipelinedDataplane: RX, forwarding, and TX on separate threads.
+//
+//   RX thread 0 ─ ring ─┐                 ┌─ ring ─ TX thread 0
+//   RX thread 1 ─ ring ─┼─ forwarding ────┼─ ring ─ TX thread 1
+//        ...            ┘    thread       └          ...
+//
+// Ports are spread over the RX threads and over the TX threads by port
+// number. An RX thread receives frames into pool buffers and passes them
+// on through its SPSC ring. The forwarding thread runs every frame through
+// FramePipeline, the same stages as the run-to-completion core, and hands
+// one descriptor per egress port to the ring of the TX thread owning that
+// port; a flooded frame is not copied, each descriptor holds a buffer
+// reference. TX threads send through the per-port TX queues.
+//
+// TX threads send frames as they get them. The forwarding thread sets the
+// VLAN tag of a frame for its egress ports while it holds the only
+// reference; once a frame is handed to a TX thread, it is copied once for
+// the egress ports that need the other tagging.
+//
+// So receive and send syscalls overlap with forwarding. A frame is dropped
+// when the next ring is full, counted per ring. Threads can be pinned to
+// cores, in the order RX threads, forwarding thread, TX threads.
+// -----------------------------------------------------------------------------
+template <typename FramePipeline>
+class PipelinedDataplane {
+public:
+    enum {
+        RingSize  = 1024,   // Descriptors per ring
+        RingBurst = 32      // Descriptors taken from a ring at once
+    };
+
+    PipelinedDataplane(PortId numPorts, PacketPool& pool, DataplaneConfig const& config);
+
+    // Start the RX and TX threads and run forwarding on the calling thread;
+    // never returns
+    [[noreturn]] void run();
+
+    // -------------------------------------------------------------------------
+    // Used by pipeline stages, on the forwarding thread
+    // -------------------------------------------------------------------------
+    DataplaneStats& stats() { return stats_; }
+
+    PortStats& portStats(PortId port) { return portStats_[port]; }
+
+    StormControl& stormControl() { return storm_; }
+
+    // Queue frame to the TX thread of port, with VLAN tag tci (untagged
+    // if 0)
+    void transmit(PortId port, PacketBuf& pkt, uint16_t tci);
+
+    // Invoke fn(port) for every port of egress
+    template <typename Fn>
+    void forEachPort(EgressPorts const& egress, Fn&& fn) const
+    {
+        for (PortId p : egress.ports) {
+            fn(p);
+        }
+    }
+
+private:
+    // Descriptor handed to a TX thread
+    struct TxDescriptor {
+        PacketBuf* pkt;
+        PortId     port;
+        uint16_t   tci;
+    };
+
+    struct RxWorker {
+        explicit RxWorker(std::vector<uint32_t> const& weights, PortId numLocal)
+            : ring(RingSize), ingress(numLocal, weights)
+        {}
+
+        std::vector<PortId>     ports;       // Local index → port
+        std::vector<pollfd>     pfd;         // Local index → poll entry
+        SpscRing<PacketBuf*>    ring;        // To the forwarding thread
+        IngressScheduler        ingress;
+
+        std::mutex              statsMtx;
+        std::vector<PortStats>  published;   // Local index → counters, under statsMtx
+    };
+
+    struct TxWorker {
+        TxWorker() : ring(RingSize) {}
+
+        std::vector<PortId>     ports;       // Local index → port
+        SpscRing<TxDescriptor>  ring;        // From the forwarding thread
+
+        std::mutex              statsMtx;
+        std::vector<PortStats>  published;   // Local index → counters, under statsMtx
+        std::vector<uint32_t>   queued;      // Local index → TX queue depth, under statsMtx
+    };
+
+    // Thread bodies
+    [[noreturn]] void rxLoop(RxWorker& rx);
+    [[noreturn]] void txLoop(TxWorker& tx);
+
+    // Pin the calling thread to the core for thread index i, if one is configured
+    void pinThread(size_t i, char const* name) const;
+
+    // Print counters if they moved since the last dump
+    void dumpStats();
+
+private:
+    PortId const                            numPorts_;
+    std::vector<int>                        fds_;          // Port → socket, shared by all threads
+    PacketPool&                             pool_;
+    std::vector<int>                        cpus_;         // Thread index → core
+
+    std::vector<std::unique_ptr<RxWorker>>  rx_;
+    std::vector<std::unique_ptr<TxWorker>>  tx_;
+    std::vector<uint32_t>                   portTx_;       // Port → TX worker
+    std::vector<uint32_t>                   portTxIndex_;  // Port → local index in its TX worker
+
+    // Forwarding thread state
+    PacketPool::Cache                       cache_;
+    PacketBuf*                              retagged_ = nullptr;  // Copy of the current
+                                                                  // frame, other tagging
+    DataplaneStats                          stats_;
+    std::vector<PortStats>                  portStats_;    // Port → rx counters
+    StormControl                            storm_;        // Flood rate limits per port
+    uint64_t                                rxFramesDumped_ = 0;
+};
+
+// Back off from polling empty rings: spin briefly, then yield, then sleep
+inline void ring_idle_backoff(uint32_t& idlePasses)
+{
+    idlePasses++;
+    if (idlePasses < 64) {
+        cpu_relax();
+    } else if (idlePasses < 1024) {
+        std::this_thread::yield();
+    } else {
+        usleep(50);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+template <typename FramePipeline>
+PipelinedDataplane<FramePipeline>::PipelinedDataplane(
+    PortId const numPorts,
+    PacketPool& pool,
+    DataplaneConfig const& config)
+    : numPorts_{numPorts},
+      fds_(numPorts),
+      pool_{pool},
+      cpus_{config.cpus},
+      portTx_(numPorts),
+      portTxIndex_(numPorts),
+      cache_{pool},
+      portStats_(numPorts),
+      storm_{numPorts}
+{
+    std::vector<pollfd> pfd(numPorts_);
+    initialize_fds(fds_.data(), pfd.data(), numPorts_);
+
+    uint32_t const numRx = std::max<uint32_t>(1, std::min<uint32_t>(config.rxThreads, numPorts_));
+    uint32_t const numTx = std::max<uint32_t>(1, std::min<uint32_t>(config.txThreads, numPorts_));
+
+    for (uint32_t r = 0; r < numRx; r++) {
+        // Ports r, r + numRx, ... with their weights
+        std::vector<uint32_t> weights;
+        PortId numLocal = 0;
+        for (PortId port = r; port < numPorts_; port += numRx) {
+            weights.push_back(port < config.portWeights.size() ? config.portWeights[port] : 1);
+            numLocal++;
+        }
+
+        auto rx = std::make_unique<RxWorker>(weights, numLocal);
+        for (PortId port = r; port < numPorts_; port += numRx) {
+            rx->ports.push_back(port);
+            rx->pfd.push_back(pollfd{fds_[port], POLLIN, 0});
+        }
+        rx->published.resize(numLocal);
+        rx_.push_back(std::move(rx));
+    }
+
+    for (uint32_t t = 0; t < numTx; t++) {
+        auto tx = std::make_unique<TxWorker>();
+        for (PortId port = t; port < numPorts_; port += numTx) {
+            portTx_[port] = t;
+            portTxIndex_[port] = static_cast<uint32_t>(tx->ports.size());
+            tx->ports.push_back(port);
+        }
+        tx->published.resize(tx->ports.size());
+        tx->queued.resize(tx->ports.size());
+        tx_.push_back(std::move(tx));
+    }
+
+    std::cout << "[DP] pipelined: " << numRx << " RX threads, " << numTx << " TX threads\n";
+}
+
+template <typename FramePipeline>
+void PipelinedDataplane<FramePipeline>::pinThread(size_t const i, char const* const name) const
+{
+    if (i < cpus_.size()) {
+        pin_thread_to_cpu(cpus_[i], name);
+    }
+}
+
+template <typename FramePipeline>
+void PipelinedDataplane<FramePipeline>::run()
+{
+    // Thread index: RX threads, then forwarding, then TX threads.
+    size_t thread = 0;
+    for (auto& rx : rx_) {
+        std::thread([this, &rx, thread] {
+            pinThread(thread, "rx");
+            rxLoop(*rx);
+        }).detach();
+        thread++;
+    }
+    size_t const fwdThread = thread++;
+    for (auto& tx : tx_) {
+        std::thread([this, &tx, thread] {
+            pinThread(thread, "tx");
+            txLoop(*tx);
+        }).detach();
+        thread++;
+    }
+    pinThread(fwdThread, "forwarding");
+
+    // ------------------------------------------------------------------
+    // Forwarding Loop
+    // ------------------------------------------------------------------
+    std::array<PacketBuf*, RingBurst> burst;
+    uint32_t idlePasses = 0;
+    auto idleSince = std::chrono::steady_clock::now();
+
+    for (;;) {
+        bool busy = false;
+        for (auto& rx : rx_) {
+            uint32_t const n = rx->ring.popBurst(burst.data(), RingBurst);
+            for (uint32_t i = 0; i < n; i++) {
+                PacketBuf* const pkt = burst[i];
+
+                uint64_t const start = read_cycles();
+                FrameContext ctx;
+                ctx.pkt = pkt;
+                ctx.port = pkt->port;
+                FramePipeline::process(*this, ctx);
+                stats_.procCycles += read_cycles() - start;
+
+                pool_.release(cache_, pkt);
+                if (retagged_) {
+                    pool_.release(cache_, retagged_);
+                    retagged_ = nullptr;
+                }
+            }
+            busy |= (n != 0);
+        }
+
+        if (busy) {
+            idlePasses = 0;
+            continue;
+        }
+        if (idlePasses == 0) {
+            idleSince = std::chrono::steady_clock::now();
+        }
+        ring_idle_backoff(idlePasses);
+        if ((idlePasses & 1023) == 0 &&
+            std::chrono::steady_clock::now() - idleSince > std::chrono::seconds(1)) {
+            dumpStats();
+        }
+    }
+}
+
+template <typename FramePipeline>
+void PipelinedDataplane<FramePipeline>::transmit(
+    PortId const port,
+    PacketBuf& pkt,
+    uint16_t const tci)
+{
+    // Egress ports come grouped by tagging, so a frame needs at most one
+    // copy, made on its first port with the other tagging; only tagged
+    // ports of both TPIDs in one VLAN may need a copy per TPID.
+    uint16_t const tpid = g_switch_state.portSettings(port).tpid;
+    PacketBuf* out = &pkt;
+    if (!pkt.hasVlanTag(tpid, tci)) {
+        if (pkt.refcnt.load(std::memory_order_acquire) == 1) {
+            pkt.setVlanTag(tpid, tci);
+        } else {
+            if (!retagged_ || !retagged_->hasVlanTag(tpid, tci)) {
+                if (retagged_) {
+                    pool_.release(cache_, retagged_);
+                }
+                retagged_ = pool_.clone(cache_, pkt);
+                if (!retagged_)
+                    return;
+                retagged_->setVlanTag(tpid, tci);
+            }
+            out = retagged_;
+        }
+    }
+
+    // The descriptor holds its own reference; on a full ring it is dropped
+    // again right away, and the ring counts the drop.
+    PacketPool::ref(out);
+    if (!tx_[portTx_[port]]->ring.push(TxDescriptor{out, port, tci})) {
+        pool_.release(cache_, out);
+    }
+}
+
+template <typename FramePipeline>
+void PipelinedDataplane<FramePipeline>::rxLoop(RxWorker& rx)
+{
+    ssize_t const minFrameLen = 2 * MacAddressByteLen + 2;
+
+    PacketPool::Cache cache(pool_);
+    std::vector<PortStats> stats(rx.ports.size());
+    PortId const numLocal = static_cast<PortId>(rx.ports.size());
+
+    for (;;) {
+        int const ret = poll(rx.pfd.data(), numLocal, 100);
+        if (ret < 0) {
+            perror("poll");
+            continue;
+        }
+        if (ret == 0) {
+            std::lock_guard<std::mutex> lock(rx.statsMtx);
+            rx.published = stats;
+            continue;
+        }
+
+        for (pollfd& p : rx.pfd) {
+            if (p.revents & POLLERR)
+                clear_port_error(p.fd);
+        }
+
+        rx.ingress.serve(rx.pfd.data(), IngressBurstMax, stats.data(), [&](PortId const local) {
+            PacketBuf* const pkt = pool_.alloc(cache);
+            if (!pkt)
+                return false;
+
+            PortId const port = rx.ports[local];
+            ssize_t const n = recv_port_frame(fds_[port], *pkt, g_switch_state.portSettings(port).tpid);
+            if (n < minFrameLen) {
+                pool_.release(cache, pkt);
+                // Drained, or a runt frame
+                return n >= 0;
+            }
+            pkt->port = port;
+
+            if (!rx.ring.push(pkt)) {
+                pool_.release(cache, pkt);
+            }
+            return true;
+        });
+    }
+}
+
+template <typename FramePipeline>
+void PipelinedDataplane<FramePipeline>::txLoop(TxWorker& tx)
+{
+    PacketPool::Cache cache(pool_);
+    size_t const numLocal = tx.ports.size();
+    std::vector<PortStats> stats(numLocal);
+    std::vector<TxQueue> txq(numLocal);
+    std::vector<pollfd> pfd(numLocal);
+    for (size_t i = 0; i < numLocal; i++) {
+        pfd[i] = pollfd{fds_[tx.ports[i]], POLLOUT, 0};
+        txq[i].setTpid(g_switch_state.portSettings(tx.ports[i]).tpid);
+    }
+
+    std::array<TxDescriptor, RingBurst> burst;
+    uint32_t idlePasses = 0;
+    uint32_t queuedPorts = 0;   // Ports with a non-empty TX queue
+
+    for (;;) {
+        uint32_t const n = tx.ring.popBurst(burst.data(), RingBurst);
+        for (uint32_t i = 0; i < n; i++) {
+            TxDescriptor const& desc = burst[i];
+            uint32_t const local = portTxIndex_[desc.port];
+            bool const wasEmpty = txq[local].empty();
+            txq[local].transmit(fds_[desc.port], desc.pkt, desc.tci, stats[local]);
+            if (wasEmpty && !txq[local].empty()) {
+                queuedPorts++;
+            }
+            pool_.release(cache, desc.pkt);
+        }
+
+        // Retry queued frames of the ports that became writable.
+        if (queuedPorts != 0) {
+            for (size_t i = 0; i < numLocal; i++) {
+                pfd[i].fd = txq[i].empty() ? -1 : fds_[tx.ports[i]];
+            }
+            if (poll(pfd.data(), numLocal, 0) > 0) {
+                for (size_t i = 0; i < numLocal; i++) {
+                    if (pfd[i].revents & POLLERR) {
+                        clear_port_error(pfd[i].fd);
+                    }
+                    if (pfd[i].revents & POLLOUT) {
+                        txq[i].flush(fds_[tx.ports[i]], pool_, cache, stats[i]);
+                        if (txq[i].empty()) {
+                            queuedPorts--;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (n != 0) {
+            idlePasses = 0;
+            continue;
+        }
+        ring_idle_backoff(idlePasses);
+        if ((idlePasses & 1023) == 0) {
+            std::lock_guard<std::mutex> lock(tx.statsMtx);
+            tx.published = stats;
+            for (size_t i = 0; i < numLocal; i++) {
+                tx.queued[i] = txq[i].size();
+            }
+        }
+    }
+}
+
+template <typename FramePipeline>
+void PipelinedDataplane<FramePipeline>::dumpStats()
+{
+    // Idle; dump the counters if they moved since the last dump.
+    if (stats_.rxFrames() == rxFramesDumped_) {
+        return;
+    }
+    rxFramesDumped_ = stats_.rxFrames();
+
+    // Receive counters are kept by the forwarding thread, scheduler counters
+    // by the RX threads, and transmit counters by the TX threads.
+    std::vector<PortStats> ports = portStats_;
+    std::vector<uint32_t> queued(numPorts_);
+    for (auto& rx : rx_) {
+        std::lock_guard<std::mutex> lock(rx->statsMtx);
+        for (size_t i = 0; i < rx->ports.size(); i++) {
+            ports[rx->ports[i]].rxTurns = rx->published[i].rxTurns;
+            ports[rx->ports[i]].rxThrottled = rx->published[i].rxThrottled;
+        }
+    }
+    for (auto& tx : tx_) {
+        std::lock_guard<std::mutex> lock(tx->statsMtx);
+        for (size_t i = 0; i < tx->ports.size(); i++) {
+            PortStats& port = ports[tx->ports[i]];
+            PortStats const& published = tx->published[i];
+            port.txFrames = published.txFrames;
+            port.txDrops = published.txDrops;
+            port.txRetries = published.txRetries;
+            port.txQueueMax = published.txQueueMax;
+            queued[tx->ports[i]] = tx->queued[i];
+        }
+    }
+
+    std::cout << "== Dataplane Stats ==\n";
+    std::cout << stats_.tostring();
+    for (PortId port = 0; port < numPorts_; port++) {
+        std::cout << ports[port].tostring(port, queued[port]);
+    }
+    std::cout << tostring_lag_stats(ports);
+    std::cout << g_switch_state.tostringMcast();
+    for (size_t r = 0; r < rx_.size(); r++) {
+        SpscRing<PacketBuf*> const& ring = rx_[r]->ring;
+        ::printf("ring rx%zu->fwd: depth=%u avg=%" PRIu64 " max=%u/%u drops=%" PRIu64 "\n",
+            r, ring.size(), ring.avgOccupancy(), ring.highWater(), ring.capacity(), ring.drops());
+    }
+    for (size_t t = 0; t < tx_.size(); t++) {
+        SpscRing<TxDescriptor> const& ring = tx_[t]->ring;
+        ::printf("ring fwd->tx%zu: depth=%u avg=%" PRIu64 " max=%u/%u drops=%" PRIu64 "\n",
+            t, ring.size(), ring.avgOccupancy(), ring.highWater(), ring.capacity(), ring.drops());
+    }
+    std::cout << pool_.tostring();
+    std::cout << std::endl;
+
+    // No leak check here: other threads may still hold buffers in flight.
+}
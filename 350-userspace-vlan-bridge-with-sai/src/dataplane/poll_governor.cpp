@@ -0,0 +1,111 @@
+#include "poll_governor.h"
+#include "cycles.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+// -----------------------------------------------------------------------------
+PollGovernor::PollGovernor(
+    Mode const mode,
+    uint32_t const idleUsecs,
+    uint32_t const burstMax)
+    : mode_{mode},
+      idleThreshold_{std::chrono::microseconds(idleUsecs)},
+      burstMax_{burstMax},
+      state_{mode == Mode::BusyPoll ? State::Spin : State::Block},
+      stateSince_{Clock::now()},
+      idleSince_{stateSince_},
+      lastDump_{stateSince_}
+{
+}
+
+int PollGovernor::prepare()
+{
+    switch (state_) {
+        case State::Spin:
+            return 0;
+        case State::Nap:
+            usleep(NapUsecs);
+            return 0;
+        default:
+            return BlockTimeoutMsec;
+    }
+}
+
+void PollGovernor::busy(uint32_t const frames)
+{
+    // Moving average over about 8 busy passes
+    uint32_t const sample = 16 * frames;
+    occupancy_ = occupancy_ - occupancy_ / 8 + sample / 8;
+
+    Clock::time_point const now = Clock::now();
+    idleSince_ = now;
+    if (mode_ != Mode::Blocking && state_ != State::Spin) {
+        wakeups_++;
+        enter(State::Spin, now);
+    }
+}
+
+bool PollGovernor::idle()
+{
+    Clock::time_point const now = Clock::now();
+
+    if (mode_ == Mode::Adaptive) {
+        Clock::duration const idleFor = now - idleSince_;
+        if (state_ == State::Spin && idleFor > spinWindow()) {
+            enter(State::Nap, now);
+        } else if (state_ == State::Nap && idleFor > idleThreshold_) {
+            enter(State::Block, now);
+        }
+    }
+    if (state_ == State::Spin) {
+        cpu_relax();
+    }
+
+    if (now - idleSince_ < std::chrono::seconds(1) ||
+        now - lastDump_ < std::chrono::seconds(1)) {
+        return false;
+    }
+    lastDump_ = now;
+    return true;
+}
+
+void PollGovernor::enter(State const state, Clock::time_point const now)
+{
+    stateNs_[static_cast<size_t>(state_)] += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - stateSince_).count());
+    state_ = state;
+    stateSince_ = now;
+}
+
+PollGovernor::Clock::duration PollGovernor::spinWindow() const
+{
+    // Scale from the minimum to the maximum window as bursts fill up.
+    uint64_t const fill = std::min<uint64_t>(occupancy_, 16 * burstMax_);
+    uint64_t const usecs = SpinMinUsecs +
+        (SpinMaxUsecs - SpinMinUsecs) * fill / (16 * uint64_t{burstMax_});
+    return std::chrono::microseconds(usecs);
+}
+
+std::string PollGovernor::tostring() const
+{
+    if (mode_ != Mode::Adaptive) {
+        return {};
+    }
+
+    // Include the time spent in the current state so far.
+    std::array<uint64_t, static_cast<size_t>(State::NumStates)> ns = stateNs_;
+    ns[static_cast<size_t>(state_)] += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - stateSince_).count());
+
+    char buf[160];
+    int const n = std::snprintf(buf, sizeof(buf),
+        "poll: spin=%" PRIu64 "ms nap=%" PRIu64 "ms block=%" PRIu64 "ms wakeups=%" PRIu64
+        " burst-occupancy=%u.%02u\n",
+        ns[0] / 1000000, ns[1] / 1000000, ns[2] / 1000000,
+        wakeups_, occupancy_ / 16, (occupancy_ % 16) * 100 / 16);
+    return (n > 0) ? std::string(buf, static_cast<size_t>(n)) : std::string{};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// -----------------------------------------------------------------------------
+// PollGovernor: decides how the dataplane loop waits for frames.
+//
+//  - Spin:  poll() without timeout, pause between idle passes
+//  - Nap:   sleep NapUsecs, then poll() without timeout
+//  - Block: poll() until a frame arrives (or the 1 s stats timeout)
+//
+// Blocking mode always blocks and busy-poll mode always spins. Adaptive
+// mode spins while frames flow, naps once the ports were idle for the
+// spin window, and blocks once they were idle for the idle threshold.
+// The spin window follows the recent RX burst occupancy, the average
+// number of frames per busy pass: large bursts mean a loaded switch,
+// where the next frame is likely close, so the loop spins longer.
+//
+// The governor accounts the time spent in each state, and the frame
+// counts per wake-up from Nap or Block.
+// -----------------------------------------------------------------------------
+class PollGovernor {
+public:
+    enum class Mode : uint8_t {
+        Blocking,
+        BusyPoll,
+        Adaptive
+    };
+
+    enum class State : uint8_t {
+        Spin,
+        Nap,
+        Block,
+        NumStates
+    };
+
+    enum {
+        NapUsecs         = 20,    // Sleep per Nap pass
+        SpinMinUsecs     = 20,    // Spin window when bursts are small
+        SpinMaxUsecs     = 500,   // Spin window when bursts are full
+        BlockTimeoutMsec = 1000   // Block timeout; dump the stats when it expires
+    };
+
+    // idleUsecs: idle time after which adaptive mode blocks;
+    // burstMax: frames of a full RX burst
+    PollGovernor(Mode mode, uint32_t idleUsecs, uint32_t burstMax);
+
+    // poll() timeout of the next pass; naps first in Nap state
+    int prepare();
+
+    // True while waiting in Nap or Block, so the next frames are a wake-up
+    bool sleeping() const { return state_ != State::Spin; }
+
+    // Account a pass that received frames
+    void busy(uint32_t frames);
+
+    // Account a pass that received nothing; true if the ports were idle
+    // long enough to dump the stats
+    bool idle();
+
+    // String representation of the state times and wake-ups
+    std::string tostring() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // Move to state at now, accounting the time spent in the old one
+    void enter(State state, Clock::time_point now);
+
+    // Spin window for the current burst occupancy
+    Clock::duration spinWindow() const;
+
+private:
+    Mode const                 mode_;
+    Clock::duration const      idleThreshold_;
+    uint32_t const             burstMax_;
+
+    State                      state_;
+    Clock::time_point          stateSince_;
+    Clock::time_point          idleSince_;      // Last pass that received frames
+    Clock::time_point          lastDump_;
+    uint32_t                   occupancy_ = 0;  // Average frames per busy pass, × 16
+
+    std::array<uint64_t, static_cast<size_t>(State::NumStates)> stateNs_{};
+    uint64_t                   wakeups_ = 0;    // Passes that left Nap or Block
+};
@@ -0,0 +1,487 @@
+#include "sharded_dataplane.h"
+#include "cycles.h"
+#include "arp_suppression.h"
+#include "mcast_snooping.h"
+
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+// -----------------------------------------------------------------------------
+ShardedDataplane::Worker::Worker(
+    uint32_t const workerId,
+    PortId const numPorts,
+    std::vector<uint32_t> const& weights)
+    : id{workerId},
+      eventFd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)},
+      pfd(numPorts + 1, pollfd{-1, 0, 0}),
+      ingress{numPorts, weights},
+      txq(numPorts),
+      portStats(numPorts),
+      publishedPortStats(numPorts),
+      publishedQueued(numPorts)
+{
+    if (eventFd < 0) {
+        perror("eventfd");
+        exit(1);
+    }
+    for (PortId port = 0; port < numPorts; port++) {
+        txq[port].setTpid(g_switch_state.portSettings(port).tpid);
+    }
+    fdbIndex.reset(numPorts);
+    flushesSeen = g_switch_state.fdbFlushes();
+    portFlushesSeen = g_switch_state.portFlushes();
+    portFlushesSeen.resize(numPorts);
+    pfd[numPorts] = pollfd{eventFd, POLLIN, 0};
+}
+
+ShardedDataplane::Worker::~Worker()
+{
+    close(eventFd);
+}
+
+// -----------------------------------------------------------------------------
+ShardedDataplane::ShardedDataplane(
+    PortId const numPorts,
+    PacketPool& pool,
+    DataplaneConfig const& config)
+    : numPorts_{numPorts},
+      numWorkers_{std::max<uint32_t>(1, config.shards)},
+      fds_(numPorts),
+      pool_{pool},
+      storm_{numPorts},
+      cpus_{config.cpus}
+{
+    std::vector<pollfd> pfd(numPorts_);
+    initialize_fds(fds_.data(), pfd.data(), numPorts_);
+
+    for (uint32_t id = 0; id < numWorkers_; id++) {
+        auto w = std::make_unique<Worker>(id, numPorts_, config.portWeights);
+        w->fdb.reserve(FdbEntriesPerPort * numPorts_ / numWorkers_);
+        for (PortId port = id; port < numPorts_; port += numWorkers_) {
+            w->pfd[port] = pollfd{fds_[port], POLLIN, 0};
+        }
+
+        w->inbox.resize(numWorkers_);
+        for (uint32_t from = 0; from < numWorkers_; from++) {
+            if (from != id) {
+                w->inbox[from] = std::make_unique<SpscRing<Message>>(RingSize);
+            }
+        }
+        w->notify.resize(numWorkers_);
+        workers_.push_back(std::move(w));
+    }
+
+    std::cout << "[DP] sharded: " << numWorkers_ << " workers\n";
+}
+
+uint32_t ShardedDataplane::owner(VlanId const vlan, MacAddress const mac) const
+{
+    // The FDB slices index their buckets with the low hash bits, so pick
+    // the owner from the high bits to keep each slice evenly spread.
+    uint64_t const h = FdbHashTable::hash(FdbKey(vlan, mac).packed());
+    return static_cast<uint32_t>(((h >> 32) * numWorkers_) >> 32);
+}
+
+void ShardedDataplane::run()
+{
+    for (uint32_t id = 1; id < numWorkers_; id++) {
+        std::thread([this, id] {
+            if (id < cpus_.size()) {
+                pin_thread_to_cpu(cpus_[id], "worker");
+            }
+            workerLoop(*workers_[id]);
+        }).detach();
+    }
+    if (!cpus_.empty()) {
+        pin_thread_to_cpu(cpus_[0], "worker");
+    }
+    workerLoop(*workers_[0]);
+}
+
+void ShardedDataplane::workerLoop(Worker& w)
+{
+    ssize_t const minFrameLen = 2 * MacAddressByteLen + 2;
+
+    PacketPool::Cache cache(pool_);
+    bool backlog = false;
+
+    // ------------------------------------------------------------------
+    // Worker Loop
+    // ------------------------------------------------------------------
+    for (;;) {
+
+        int const ret = poll(w.pfd.data(), numPorts_ + 1, backlog ? 0 : 1000);
+        if (ret < 0) {
+            perror("poll");
+            continue;
+        }
+        // Age the FDB slice once per timer tick; the poll timeout makes
+        // sure an idle worker gets here every second.
+        AgingTimer::Tick const now = g_aging_timer.now();
+        if (now != w.agedAt) {
+            w.agedAt = now;
+            age(w, now);
+        }
+        uint64_t const flushes = g_switch_state.fdbFlushes();
+        if (flushes != w.flushesSeen) {
+            flushPorts(w, flushes);
+        }
+
+        if (ret == 0 && !backlog) {
+            publishStats(w);
+            if (w.id == 0) {
+                dumpStats();
+            }
+            continue;
+        }
+
+        // Reset the wake-up before draining, so that no message is missed.
+        if (w.pfd[numPorts_].revents & POLLIN) {
+            uint64_t wakeups;
+            ssize_t const n = read(w.eventFd, &wakeups, sizeof(wakeups));
+            (void)n;
+        }
+        backlog = drainInbox(w, cache);
+
+        for (PortId port = 0; port < numPorts_; port++) {
+            pollfd& p = w.pfd[port];
+            if (p.revents & POLLERR)
+                clear_port_error(p.fd);
+
+            if (p.revents & POLLOUT) {
+                w.txq[port].flush(fds_[port], pool_, cache, w.portStats[port]);
+                if (w.txq[port].empty()) {
+                    p.events = static_cast<short>(p.events & ~POLLOUT);
+                    if (p.events == 0) {
+                        p.fd = -1;
+                    }
+                }
+            }
+        }
+
+        w.ingress.serve(w.pfd.data(), IngressBurstMax, w.portStats.data(), [&](PortId const port) {
+            PacketBuf* const pkt = pool_.alloc(cache);
+            if (!pkt)
+                return false;
+
+            ssize_t const n = recv_port_frame(fds_[port], *pkt, g_switch_state.portSettings(port).tpid);
+            if (n >= minFrameLen) {
+                pkt->port = port;
+
+                uint64_t const start = read_cycles();
+                receiveFrame(w, cache, pkt, port);
+                w.stats.procCycles += read_cycles() - start;
+            }
+            pool_.release(cache, pkt);
+            // Drained, or a frame was taken
+            return n >= 0;
+        });
+
+        notifyWorkers(w);
+    }
+}
+
+void ShardedDataplane::receiveFrame(
+    Worker& w,
+    PacketPool::Cache& cache,
+    PacketBuf* const pkt,
+    PortId const port)
+{
+    uint8_t const* const frame = pkt->data;
+    MacAddress const dmac = extract_mac(frame);
+    MacAddress const smac = extract_mac(frame + MacAddressByteLen);
+
+    MacClass const dmacClass = classify_mac(dmac);
+    w.stats.countRx(dmacClass);
+    w.portStats[port].rxFrames++;
+
+    // Classify by VLAN tag or PVID; drop tagged frames of VLANs the
+    // port is not a member of.
+    VlanId vlan = DefaultVlanId;
+    LearnMode learnMode = LearnMode::Hardware;
+    VlanId const vid = pkt->vlanTagged ? (pkt->vlanTci() & VlanIdMask) : 0;
+    if (!g_switch_state.classifyVlan(port, pkt->vlanTagged, vid, vlan, learnMode)) {
+        w.stats.vlanDrops++;
+        return;
+    }
+
+    // Frames that are not learned need no Learn message either. Sources
+    // received on a LAG member are learned at the LAG.
+    uint32_t const learnOwner = owner(vlan, smac);
+    PortId const learnPort = g_switch_state.lagPort(port);
+    if (learnMode != LearnMode::Hardware) {
+        reportUnlearned(vlan, smac, port, learnMode);
+    } else if (learnOwner == w.id) {
+        learn(w, vlan, smac, learnPort);
+    } else {
+        w.workerStats.learnHandoffs++;
+        post(w, learnOwner, Message{Message::Type::Learn, vlan, learnPort, smac, nullptr});
+    }
+
+    // ARP / ND requests for a bound target are looked up under the
+    // owner's MAC.
+    MacAddress lookupMac = dmac;
+    bool lookup = dmacClass == MacClass::Unicast;
+    uint16_t const ethtype = extract_payload_ethertype(frame);
+    if (is_arp_nd_ethertype(ethtype)) {
+        MacAddress neighOwner = 0;
+        switch (arp_nd_snoop(vlan, learnMode, ethtype, frame, pkt->len, neighOwner)) {
+            case NeighLookup::Hit:
+                w.stats.neighHits++;
+                lookupMac = neighOwner;
+                lookup = true;
+                break;
+            case NeighLookup::Miss:
+                w.stats.neighMisses++;
+                break;
+            case NeighLookup::None:
+                break;
+        }
+    }
+
+    // Group addresses are never in the FDB; unless the owner of an ARP / ND
+    // target is looked up for them, flood them right here.
+    if (lookup) {
+        uint32_t const lookupOwner = owner(vlan, lookupMac);
+        if (lookupOwner != w.id) {
+            w.workerStats.fwdHandoffs++;
+            PacketPool::ref(pkt);
+            if (!post(w, lookupOwner, Message{Message::Type::Forward, vlan, port, lookupMac, pkt})) {
+                pool_.release(cache, pkt);
+            }
+            return;
+        }
+    }
+
+    forward(w, pkt, vlan, dmacClass, lookup ? &lookupMac : nullptr, port);
+}
+
+bool ShardedDataplane::drainInbox(Worker& w, PacketPool::Cache& cache)
+{
+    std::array<Message, RingBurst> burst;
+    uint32_t budget = IngressBurstMax;
+    bool backlog = false;
+
+    for (auto& ring : w.inbox) {
+        if (!ring)
+            continue;
+
+        uint32_t n;
+        while ((n = ring->popBurst(burst.data(), std::min<uint32_t>(RingBurst, budget))) != 0) {
+            uint64_t const start = read_cycles();
+            for (uint32_t i = 0; i < n; i++) {
+                Message const& msg = burst[i];
+                if (msg.type == Message::Type::Learn) {
+                    learn(w, msg.vlan, msg.mac, msg.port);
+                } else {
+                    MacClass const dmacClass = classify_mac(extract_mac(msg.pkt->data));
+                    forward(w, msg.pkt, msg.vlan, dmacClass, &msg.mac, msg.port);
+                    pool_.release(cache, msg.pkt);
+                }
+            }
+            w.stats.procCycles += read_cycles() - start;
+            w.workerStats.messages += n;
+
+            budget -= n;
+            if (budget == 0) {
+                break;
+            }
+        }
+        backlog |= (ring->size() != 0);
+    }
+    return backlog;
+}
+
+void ShardedDataplane::learn(Worker& w, VlanId const vlan, MacAddress const mac, PortId const port)
+{
+    learn_fdb_entry(w.fdb, vlan, mac, port, g_aging_timer.now(), &w.fdbIndex);
+    w.workerStats.fdbEntries = w.fdb.size();
+}
+
+void ShardedDataplane::age(Worker& w, AgingTimer::Tick const now)
+{
+    FdbHashTable::Stamp const cutoff = fdb_aging_cutoff(now, g_switch_state.fdbAgingTime());
+    if (cutoff != 0) {
+        w.workerStats.fdbAged += age_fdb_entries(w.fdb, cutoff, &w.fdbIndex);
+        w.workerStats.fdbEntries = w.fdb.size();
+    }
+}
+
+void ShardedDataplane::flushPorts(Worker& w, uint64_t const flushes)
+{
+    w.flushesSeen = flushes;
+    std::vector<uint64_t> const portFlushes = g_switch_state.portFlushes();
+    for (PortId port = 0; port < numPorts_ && port < portFlushes.size(); port++) {
+        if (portFlushes[port] != w.portFlushesSeen[port]) {
+            w.portFlushesSeen[port] = portFlushes[port];
+            w.workerStats.fdbFlushed += w.fdbIndex.flush(w.fdb, port);
+        }
+    }
+    w.workerStats.fdbEntries = w.fdb.size();
+}
+
+void ShardedDataplane::forward(
+    Worker& w,
+    PacketBuf* const pkt,
+    VlanId const vlan,
+    MacClass const dmacClass,
+    MacAddress const* const lookupMac,
+    PortId const port)
+{
+    // The frame is still as received, so its tag gives the priority.
+    uint16_t const tci = pkt->egressTci(vlan);
+
+    if (lookupMac) {
+        PortId const* const out = w.fdb.find(FdbKey(vlan, *lookupMac).packed());
+        if (out && *out != g_switch_state.lagPort(port)) {
+            w.stats.fwdUnicast++;
+            transmit(w, pkt, member(pkt, *out), g_switch_state.isTaggedEgress(vlan, *out) ? tci : 0);
+            return;
+        }
+    }
+
+    // Multicast frames flood to the ports snooping allows; the membership
+    // messages among them are punted to snooping here.
+    PortBitmap allowed = AllPortsBitmap;
+    if (dmacClass == MacClass::Multicast) {
+        McastControl control;
+        allowed = mcast_egress_ports(vlan, port, pkt->data, pkt->len, control);
+        if (control != McastControl::None) {
+            w.stats.mcastSnooped++;
+        }
+    }
+
+    if (!storm_.admit(port, dmacClass, pkt->len)) {
+        w.portStats[port].countStormDrop(dmacClass);
+        return;
+    }
+    if (dmacClass == MacClass::Unicast) {
+        w.stats.floodUnknown++;
+    } else if (allowed != AllPortsBitmap) {
+        w.stats.fwdMulticast++;
+    } else {
+        w.stats.floodGroup++;
+    }
+
+    // Flood inside VLAN using the precomputed egress set of the ingress
+    // port; the ports that take the frame with its current tagging go
+    // first, so that its tag changes at most once.
+    VlanFloodSetsPtr const floodSets = g_switch_state.getFloodSets(vlan);
+    FloodSet const& floodSet = (*floodSets)[port];
+    bool const tagged = pkt->vlanTagged;
+    for (PortId p : (tagged ? floodSet.tagged : floodSet.untagged).ports) {
+        if (bitmap_has_port(allowed, p)) {
+            transmit(w, pkt, member(pkt, p), tagged ? tci : 0);
+        }
+    }
+    for (PortId p : (tagged ? floodSet.untagged : floodSet.tagged).ports) {
+        if (bitmap_has_port(allowed, p)) {
+            transmit(w, pkt, member(pkt, p), tagged ? 0 : tci);
+        }
+    }
+}
+
+PortId ShardedDataplane::member(PacketBuf const* const pkt, PortId const port)
+{
+    if (!g_switch_state.isLag(port)) {
+        return port;
+    }
+    return g_switch_state.lagMember(port, flow_hash(pkt->data, pkt->len));
+}
+
+void ShardedDataplane::transmit(Worker& w, PacketBuf* const pkt, PortId const port,
+                                uint16_t const tci)
+{
+    TxQueue& txq = w.txq[port];
+    txq.transmit(fds_[port], pkt, tci, w.portStats[port]);
+    if (!txq.empty()) {
+        w.pfd[port].fd = fds_[port];
+        w.pfd[port].events |= POLLOUT;
+    }
+}
+
+bool ShardedDataplane::post(Worker& w, uint32_t const to, Message const& msg)
+{
+    if (!workers_[to]->inbox[w.id]->push(msg)) {
+        return false;
+    }
+    w.notify[to] = 1;
+    return true;
+}
+
+void ShardedDataplane::notifyWorkers(Worker& w)
+{
+    for (uint32_t to = 0; to < numWorkers_; to++) {
+        if (w.notify[to]) {
+            w.notify[to] = 0;
+            uint64_t const one = 1;
+            ssize_t const n = write(workers_[to]->eventFd, &one, sizeof(one));
+            (void)n;
+        }
+    }
+}
+
+void ShardedDataplane::publishStats(Worker& w)
+{
+    std::lock_guard<std::mutex> lock(w.statsMtx);
+    w.publishedStats = w.stats;
+    w.publishedPortStats = w.portStats;
+    w.publishedWorkerStats = w.workerStats;
+    for (PortId port = 0; port < numPorts_; port++) {
+        w.publishedQueued[port] = w.txq[port].size();
+    }
+}
+
+void ShardedDataplane::dumpStats()
+{
+    DataplaneStats stats;
+    std::vector<PortStats> ports(numPorts_);
+    std::vector<uint32_t> queued(numPorts_);
+    std::vector<WorkerStats> workerStats(numWorkers_);
+
+    for (uint32_t id = 0; id < numWorkers_; id++) {
+        Worker& w = *workers_[id];
+        std::lock_guard<std::mutex> lock(w.statsMtx);
+        stats += w.publishedStats;
+        for (PortId port = 0; port < numPorts_; port++) {
+            ports[port] += w.publishedPortStats[port];
+            queued[port] += w.publishedQueued[port];
+        }
+        workerStats[id] = w.publishedWorkerStats;
+    }
+
+    // Idle; dump the counters if they moved since the last dump.
+    if (stats.rxFrames() == rxFramesDumped_) {
+        return;
+    }
+    rxFramesDumped_ = stats.rxFrames();
+
+    std::cout << "== Dataplane Stats ==\n";
+    std::cout << stats.tostring();
+    for (PortId port = 0; port < numPorts_; port++) {
+        std::cout << ports[port].tostring(port, queued[port]);
+    }
+    std::cout << tostring_lag_stats(ports);
+    std::cout << g_switch_state.tostringMcast();
+    for (uint32_t id = 0; id < numWorkers_; id++) {
+        WorkerStats const& ws = workerStats[id];
+        uint64_t ringDrops = 0;
+        for (auto const& ring : workers_[id]->inbox) {
+            ringDrops += ring ? ring->drops() : 0;
+        }
+        ::printf("worker %u: fdb=%" PRIu64 " fdb-aged=%" PRIu64 " fdb-flushed=%" PRIu64
+                 " learn-handoffs=%" PRIu64 " fwd-handoffs=%" PRIu64 " messages=%" PRIu64
+                 " inbox-drops=%" PRIu64 "\n",
+            id, ws.fdbEntries, ws.fdbAged, ws.fdbFlushed, ws.learnHandoffs, ws.fwdHandoffs,
+            ws.messages, ringDrops);
+    }
+    std::cout << pool_.tostring();
+    std::cout << std::endl;
+}
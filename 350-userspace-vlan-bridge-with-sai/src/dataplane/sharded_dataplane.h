@@ -0,0 +1,178 @@
+#pragma once
+
+#include "switch_dataplane.h"
+#include "switch_state.h"
+#include "dataplane_stats.h"
+#include "ingress_scheduler.h"
+#include "packet_pool.h"
+#include "spsc_ring.h"
+#include "storm_control.h"
+#include "tx_queue.h"
+
+#include <poll.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// ShardedDataplane: shared-nothing workers, each owning a slice of the FDB.
+//
+// Every worker thread receives on its own ports (port % workers) and owns
+// the FDB entries whose key hashes to it (FdbKey packing, FdbHashTable
+// hash). A worker only ever touches its own table, without locks:
+//
+//  - the source MAC is learned by its owner; if that is another worker,
+//    a Learn message goes to the owner instead
+//  - the destination MAC is looked up by its owner, which then also sends
+//    or floods the frame; if that is another worker, the frame is handed
+//    over in a Forward message, holding a buffer reference
+//  - ARP / ND requests for a bound target are looked up under the owner's
+//    MAC instead, by the worker that owns it (see arp_suppression.h)
+//
+// Each ordered pair of workers has an SPSC message ring, and a worker is
+// woken through its eventfd once per burst of messages. Group addresses
+// need no lookup and are flooded by the receiving worker. VLAN config is
+// still read from g_switch_state.
+//
+// Sharded-mode FDB entries live only in the workers, and each worker ages
+// its own slice; the stats dump lists the entries per worker. When the
+// link monitor flushes a down port from the FDB of g_switch_state, every
+// worker sees the flush count change on its next loop pass and flushes
+// the port from its own slice, in O(entries on the port). Storm
+// control buckets are shared by all workers, since unknown unicast floods
+// of a port are policed by the owner of the destination MAC.
+// -----------------------------------------------------------------------------
+class ShardedDataplane {
+public:
+    enum {
+        RingSize  = 1024,   // Messages per ring
+        RingBurst = 32      // Messages taken from a ring at once
+    };
+
+    ShardedDataplane(PortId numPorts, PacketPool& pool, DataplaneConfig const& config);
+
+    // Start workers 1.. on new threads and run worker 0 on the calling
+    // thread; never returns
+    [[noreturn]] void run();
+
+private:
+    // Message between workers
+    struct Message {
+        enum class Type : uint8_t {
+            Learn,      // Learn mac at port
+            Forward     // Look up mac and send pkt, which came in on port
+        };
+
+        Type        type;
+        VlanId      vlan;
+        PortId      port;
+        MacAddress  mac;
+        PacketBuf*  pkt;
+    };
+
+    // Per-worker counters besides the frame counters
+    struct WorkerStats {
+        uint64_t learnHandoffs = 0;   // Learn messages sent
+        uint64_t fwdHandoffs   = 0;   // Forward messages sent
+        uint64_t messages      = 0;   // Messages received
+        uint64_t fdbEntries    = 0;   // Entries of the worker's FDB slice
+        uint64_t fdbAged       = 0;   // Entries of the slice aged out
+        uint64_t fdbFlushed    = 0;   // Entries of the slice flushed, port down
+    };
+
+    struct Worker {
+        Worker(uint32_t id, PortId numPorts, std::vector<uint32_t> const& weights);
+        ~Worker();
+
+        uint32_t const          id;
+        int                     eventFd;     // Wakes the worker for messages
+        std::vector<pollfd>     pfd;         // Port → poll entry; then eventFd
+        IngressScheduler        ingress;
+        FdbHashTable            fdb;         // FDB slice of this worker
+        FdbPortIndex            fdbIndex;    // Port → keys of the slice
+        AgingTimer::Tick        agedAt = 0;  // Time the slice was last aged
+
+        // Port flushes of g_switch_state the slice followed, in total and
+        // per port
+        uint64_t                flushesSeen = 0;
+        std::vector<uint64_t>   portFlushesSeen;
+        std::vector<TxQueue>    txq;         // Port → egress queue of this worker
+
+        // Inbox: one ring per sending worker, indexed by sender; none from self
+        std::vector<std::unique_ptr<SpscRing<Message>>> inbox;
+
+        // Workers that got messages from this one since the last wake-up
+        std::vector<uint8_t>    notify;
+
+        // Counters, owned by the worker thread
+        DataplaneStats          stats;
+        std::vector<PortStats>  portStats;   // Port → counters
+        WorkerStats             workerStats;
+
+        // Snapshot of the counters for the dump, under statsMtx
+        std::mutex              statsMtx;
+        DataplaneStats          publishedStats;
+        std::vector<PortStats>  publishedPortStats;
+        std::vector<uint32_t>   publishedQueued;
+        WorkerStats             publishedWorkerStats;
+    };
+
+    // Worker that owns the FDB entry of (vlan, mac)
+    uint32_t owner(VlanId vlan, MacAddress mac) const;
+
+    // Thread body of worker w
+    [[noreturn]] void workerLoop(Worker& w);
+
+    // Process a frame received by w on port
+    void receiveFrame(Worker& w, PacketPool::Cache& cache, PacketBuf* pkt, PortId port);
+
+    // Process the messages queued to w
+    bool drainInbox(Worker& w, PacketPool::Cache& cache);
+
+    // Learn mac at port in the FDB slice of w
+    void learn(Worker& w, VlanId vlan, MacAddress mac, PortId port);
+
+    // Remove the entries of the FDB slice of w that aged out at now
+    void age(Worker& w, AgingTimer::Tick now);
+
+    // Flush the ports flushed from the FDB of g_switch_state since w last
+    // looked from the FDB slice of w; flushes is their total count now
+    void flushPorts(Worker& w, uint64_t flushes);
+
+    // Forward pkt, which came in on port, from w to the port the FDB slice
+    // of w has for lookupMac, or flood it; lookupMac is null for frames
+    // that are not looked up
+    void forward(Worker& w, PacketBuf* pkt, VlanId vlan, MacClass dmacClass,
+                 MacAddress const* lookupMac, PortId port);
+
+    // Port to send pkt to for egress port: the member of pkt's flow if
+    // port is a LAG port, else port
+    static PortId member(PacketBuf const* pkt, PortId port);
+
+    // Send pkt to port from w, with VLAN tag tci (untagged if 0)
+    void transmit(Worker& w, PacketBuf* pkt, PortId port, uint16_t tci);
+
+    // Queue message to worker to; false if its ring from w is full
+    bool post(Worker& w, uint32_t to, Message const& msg);
+
+    // Wake the workers that got messages from w
+    void notifyWorkers(Worker& w);
+
+    // Copy the counters of w for the dump
+    void publishStats(Worker& w);
+
+    // Print counters of all workers if they moved since the last dump
+    void dumpStats();
+
+private:
+    PortId const                           numPorts_;
+    uint32_t const                         numWorkers_;
+    std::vector<int>                       fds_;        // Port → socket, shared by all workers
+    PacketPool&                            pool_;
+    StormControl                           storm_;      // Flood rate limits per port
+    std::vector<int>                       cpus_;       // Worker → core
+    std::vector<std::unique_ptr<Worker>>   workers_;
+    uint64_t                               rxFramesDumped_ = 0;
+};
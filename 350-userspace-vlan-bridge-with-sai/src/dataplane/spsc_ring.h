@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// SpscRing: bounded lock-free ring between exactly one producer thread and
+// one consumer thread.
+//
+// Head and tail live on separate cache lines, and each side caches the
+// other side's index, so the shared line is only read when the ring looks
+// full (producer) or empty (consumer).
+//
+// The ring also keeps occupancy counters for the stats dump: the producer
+// counts the pushes that failed because the ring was full; the consumer
+// samples the depth, average and peak, on every popBurst(). Every counter
+// has a single writer, and other threads may read them at any time.
+// -----------------------------------------------------------------------------
+template <typename T>
+class SpscRing {
+public:
+    // capacity must be a power of two
+    explicit SpscRing(uint32_t const capacity)
+        : slots_(capacity),
+          mask_{capacity - 1}
+    {
+        assert(capacity != 0 && (capacity & mask_) == 0);
+    }
+
+    SpscRing(SpscRing const&) = delete;
+    SpscRing& operator=(SpscRing const&) = delete;
+
+    uint32_t capacity() const { return mask_ + 1; }
+
+    // Producer: append v; false if the ring is full
+    bool push(T const& v)
+    {
+        uint32_t const tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ == capacity()) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ == capacity()) {
+                bump(drops_);
+                return false;
+            }
+        }
+        slots_[tail & mask_] = v;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: move up to max entries to out; return how many
+    uint32_t popBurst(T* const out, uint32_t const max)
+    {
+        uint32_t const head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) {
+                return 0;
+            }
+        }
+
+        uint32_t const depth = cachedTail_ - head;
+        uint32_t const n = (depth < max) ? depth : max;
+        for (uint32_t i = 0; i < n; i++) {
+            out[i] = slots_[(head + i) & mask_];
+        }
+        head_.store(head + n, std::memory_order_release);
+
+        add(occupancySum_, depth);
+        bump(samples_);
+        if (depth > highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(depth, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    // Entries in the ring; approximate unless called by producer or consumer
+    uint32_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    // Pushes rejected because the ring was full
+    uint64_t drops() const { return drops_.load(std::memory_order_relaxed); }
+
+    // Highest depth seen by the consumer
+    uint32_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+    // Average depth seen by the consumer when it found entries
+    uint64_t avgOccupancy() const
+    {
+        uint64_t const samples = samples_.load(std::memory_order_relaxed);
+        return samples ? occupancySum_.load(std::memory_order_relaxed) / samples : 0;
+    }
+
+private:
+    // Single-writer counter updates, without a locked read-modify-write
+    static void bump(std::atomic<uint64_t>& counter) { add(counter, 1); }
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t const n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<T>        slots_;
+    uint32_t const        mask_;
+
+    // Consumer side
+    alignas(64) std::atomic<uint32_t> head_{0};
+    uint32_t                          cachedTail_ = 0;
+    std::atomic<uint64_t>             occupancySum_{0};
+    std::atomic<uint64_t>             samples_{0};
+    std::atomic<uint32_t>             highWater_{0};
+
+    // Producer side
+    alignas(64) std::atomic<uint32_t> tail_{0};
+    uint32_t                          cachedHead_ = 0;
+    std::atomic<uint64_t>             drops_{0};
+};
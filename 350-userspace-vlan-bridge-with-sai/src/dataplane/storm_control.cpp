@@ -0,0 +1,41 @@
+#include "storm_control.h"
+
+#include <iostream>
+
+// -----------------------------------------------------------------------------
+StormControl::StormControl(PortId const numPorts)
+    : ports_(numPorts)
+{
+    for (PortId port = 0; port < numPorts; port++) {
+        PortSettings const& settings = g_switch_state.portSettings(port);
+        configure(port, MacClass::Broadcast, settings.stormBroadcast);
+        configure(port, MacClass::Multicast, settings.stormMulticast);
+        configure(port, MacClass::Unicast, settings.stormUnknown);
+
+        if (settings.stormBroadcast.rate || settings.stormMulticast.rate ||
+            settings.stormUnknown.rate) {
+            std::cout << "[DP] port=" << port << " storm control:"
+                      << " bcast=" << tostring(settings.stormBroadcast)
+                      << " mcast=" << tostring(settings.stormMulticast)
+                      << " unknown=" << tostring(settings.stormUnknown) << "\n";
+        }
+    }
+}
+
+void StormControl::configure(PortId const port, MacClass const dmacClass,
+                             StormLimit const& limit)
+{
+    auto const cls = static_cast<size_t>(dmacClass);
+    if (limit.rate == 0) {
+        return;
+    }
+
+    // The bucket holds StormBurstMsec at the rate, and at least one frame.
+    uint64_t const minUnits = limit.bits ? StormMinBurstBytes * 8 : 1;
+    uint64_t const minBurstNs = minUnits * (TokenBucket::PicosPerSec / limit.rate) / 1000;
+    uint64_t const burstNs = std::max<uint64_t>(StormBurstMsec * 1000ull * 1000, minBurstNs);
+
+    ports_[port].bucket[cls].configure(limit.rate, burstNs);
+    ports_[port].bits[cls] = limit.bits;
+    enabled_ = true;
+}
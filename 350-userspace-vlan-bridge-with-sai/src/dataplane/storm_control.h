@@ -0,0 +1,125 @@
+#pragma once
+
+#include "switch_state.h"
+#include "port_config.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// TokenBucket: lock-free rate limiter, in units (frames or bits) per second.
+//
+// The bucket is kept as a single timestamp, the time at which it would be
+// full again (GCRA, the virtual scheduling form of a token bucket). A frame
+// that costs n units moves the timestamp n unit times ahead; it conforms if
+// the timestamp stays within the burst window of now. The update is one
+// compare-and-swap, so threads can share a bucket without a lock.
+// -----------------------------------------------------------------------------
+class TokenBucket {
+public:
+    enum : uint64_t {
+        PicosPerSec = 1000ull * 1000 * 1000 * 1000
+    };
+
+    // Allow rate units per second, in bursts of up to burstNs worth of
+    // rate; rate 0 is unlimited. Not thread safe.
+    void configure(uint64_t const rate, uint64_t const burstNs)
+    {
+        psPerUnit_ = rate ? std::max<uint64_t>(1, PicosPerSec / rate) : 0;
+        burstNs_ = burstNs;
+        tat_.store(0, std::memory_order_relaxed);
+    }
+
+    bool limited() const { return psPerUnit_ != 0; }
+
+    // Take units at time nowNs; false if that exceeds the rate
+    bool admit(uint64_t const nowNs, uint32_t const units)
+    {
+        if (!limited()) {
+            return true;
+        }
+        uint64_t const cost = units * psPerUnit_ / 1000;
+        uint64_t tat = tat_.load(std::memory_order_relaxed);
+        uint64_t next;
+        do {
+            next = std::max(tat, nowNs) + cost;
+            if (next > nowNs + burstNs_) {
+                return false;
+            }
+        } while (!tat_.compare_exchange_weak(tat, next, std::memory_order_relaxed));
+        return true;
+    }
+
+private:
+    std::atomic<uint64_t>  tat_{0};         // Time the bucket is full again, ns
+    uint64_t               psPerUnit_ = 0;  // Time one unit takes at the rate
+    uint64_t               burstNs_ = 0;    // Bucket depth, as time
+};
+
+// -----------------------------------------------------------------------------
+// StormControl: per-port rate limits of the broadcast, multicast, and
+// unknown unicast (BUM) frames a port floods, from the storm-* settings of
+// the port config.
+//
+// Every flood costs a transmit per egress port, so the limits are checked
+// on ingress, before a frame is replicated; frames over the limit are
+// dropped, and counted per port by the caller. A bucket holds
+// StormBurstMsec worth of its rate. Buckets are lock free, so the threads
+// of the sharded dataplane can police the same ingress port; each port's
+// buckets sit on their own cache line.
+// -----------------------------------------------------------------------------
+class StormControl {
+public:
+    enum {
+        StormBurstMsec = 100,       // Bucket depth, in time at the rate
+        StormMinBurstBytes = 2048   // Bucket depth of bps limits, at least
+    };
+
+    // Set up the buckets of numPorts ports from g_switch_state
+    explicit StormControl(PortId numPorts);
+
+    // Any port has a limit
+    bool enabled() const { return enabled_; }
+
+    // Clock of the buckets, in nanoseconds
+    static uint64_t nowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Take a flooded frame of len bytes and dmac class from port at nowNs;
+    // false if it exceeds the port's limit for that class
+    bool admit(PortId const port, MacClass const dmacClass, uint32_t const len,
+               uint64_t const nowNs)
+    {
+        PortBuckets& buckets = ports_[port];
+        auto const cls = static_cast<size_t>(dmacClass);
+        return buckets.bucket[cls].admit(nowNs, buckets.bits[cls] ? len * 8 : 1);
+    }
+
+    // Same, at the current time; a no-op without limits
+    bool admit(PortId const port, MacClass const dmacClass, uint32_t const len)
+    {
+        return !enabled_ || admit(port, dmacClass, len, nowNs());
+    }
+
+private:
+    // Buckets of one port, indexed by MacClass; unknown unicast floods go
+    // to the Unicast bucket
+    struct alignas(64) PortBuckets {
+        std::array<TokenBucket, 3>  bucket;
+        std::array<bool, 3>         bits = {};   // Bucket counts bits
+    };
+
+    // Configure the bucket of dmacClass at port from limit
+    void configure(PortId port, MacClass dmacClass, StormLimit const& limit);
+
+private:
+    std::vector<PortBuckets>  ports_;
+    bool                      enabled_ = false;
+};
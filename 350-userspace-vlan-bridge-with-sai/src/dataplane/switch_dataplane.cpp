@@ -1,7 +1,15 @@
+#include "switch_dataplane.h"
 #include "switch_state.h"
-#include "switch_config.h"
+#include "dataplane_core.h"
+#include "vector_dataplane.h"
+#include "packet_pool.h"
+#include "pipelined_dataplane.h"
+#include "sharded_dataplane.h"
+#include "netlink_link.h"
+#include "link_monitor.h"
 
 #include <arpa/inet.h>
+#include <netinet/in.h>
 #include <linux/if_packet.h>
 #include <net/ethernet.h>
 #include <net/if.h>
@@ -9,72 +17,323 @@
 #include <sys/socket.h>
 #include <unistd.h>
 #include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <ctime>
 #include <iostream>
+#include <thread>
 #include <vector>
 
-static uint16_t
-extract_ethertype(const uint8_t* p) {
-    return p[0] << 8 | p[1];
+uint16_t
+extract_payload_ethertype(uint8_t const* const frame) {
+    uint8_t const* p = frame + 2 * MacAddressByteLen;
+    uint16_t type = extract_ethertype(p);
+    // S-tag and C-tag, or a single tag of either
+    for (int tags = 0; tags < 2 && is_vlan_tpid(type); tags++) {
+        p += VlanTagByteLen;
+        type = extract_ethertype(p);
+    }
+    return type;
+}
+
+uint32_t
+flow_hash(uint8_t const* const frame, size_t const len) {
+    // L2: both MACs
+    uint64_t h = FdbHashTable::hash(extract_mac(frame) ^ (extract_mac(frame + MacAddressByteLen) << 16));
+
+    size_t const offset = payload_offset(frame, len);
+    uint16_t const type = extract_ethertype(frame + offset - 2);
+    uint8_t const* const p = frame + offset;
+
+    // L3: IPv4 addresses and protocol
+    uint8_t const* const end = frame + len;
+    if (type != ETH_P_IP || end - p < 20 || (p[0] >> 4) != 4) {
+        return static_cast<uint32_t>(h >> 32);
+    }
+    uint32_t saddr, daddr;
+    std::memcpy(&saddr, p + 12, sizeof(saddr));
+    std::memcpy(&daddr, p + 16, sizeof(daddr));
+    uint8_t const proto = p[9];
+    h = FdbHashTable::hash(h ^ (uint64_t{saddr} << 32 | daddr) ^ proto);
+
+    // L4: TCP and UDP ports, unless the packet is a fragment, whose
+    // fragments after the first carry no ports
+    size_t const ihl = size_t{p[0] & 0x0fu} * 4;
+    bool const fragment = ((p[6] & 0x3f) | p[7]) != 0;
+    if ((proto != IPPROTO_TCP && proto != IPPROTO_UDP) || fragment ||
+        end - p < static_cast<ptrdiff_t>(ihl + 4)) {
+        return static_cast<uint32_t>(h >> 32);
+    }
+    uint32_t ports;
+    std::memcpy(&ports, p + ihl, sizeof(ports));
+    return static_cast<uint32_t>(FdbHashTable::hash(h ^ ports) >> 32);
 }
 
 /*
- * ------------------------- TAP MANAGEMENT -----------------------------
- * openTap() attaches this userspace process to an existing TAP device.
- * This uses ioctl(TUNSETIFF) and struct ifreq.
- *
- * struct ifreq is a kernel-defined structure used for configuring
- * network interfaces. Here we fill:
+ * ------------------------- PORT SETUP ---------------------------------
+ * Every port is an AF_PACKET socket bound to the ifindex of its
+ * interface. Reading from it gives raw L2 frames; writing to it sends
+ * frames out of the interface.
  *
- *   ifr_name  = name of TAP device
- *   ifr_flags = IFF_TAP | IFF_NO_PI
- *
- * IFF_TAP  -> give us Ethernet frames
- * IFF_NO_PI -> do not prepend packet-info header
- *
- * On success, we get a file descriptor. Reading from this FD gives
- * us raw L2 frames. Writing to it injects frames into the interface.
- * 
- * Notes:
- *  - open() gets a generic TUN/TAP FD. It is not associated to any specific tap yet.
- *  - ioctl() associates the fd to tapa0, tap1 etc.
+ * initialize_fds() resolves all interfaces with one netlink link dump,
+ * then opens the sockets on up to MaxSetupThreads threads, each taking
+ * every numThreads-th port. A port whose interface is missing or whose
+ * socket cannot be opened is marked down.
  */
-void initialize_fds(int* fds, struct pollfd* pfd) {
+enum {
+    PortsPerSetupThread = 8,    // Ports opened by each setup thread
+    MaxSetupThreads     = 16
+};
+
+int open_port_socket(int const ifindex, std::string& err) {
+    // Non-blocking, so that a busy port cannot stall the others
+    int const fd = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK, htons(ETH_P_ALL));
+    if (fd < 0) {
+        err = std::string("socket: ") + strerror(errno);
+        return -1;
+    }
+
+    struct sockaddr_ll sll = {};
+    sll.sll_family   = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex  = ifindex;
+
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&sll), sizeof(sll)) < 0) {
+        err = std::string("bind: ") + strerror(errno);
+        close(fd);
+        return -1;
+    }
+
+    // With VLAN offload, the kernel strips the outer VLAN tag from
+    // received frames and passes it as auxiliary data.
+    int const on = 1;
+    if (setsockopt(fd, SOL_PACKET, PACKET_AUXDATA, &on, sizeof(on)) < 0) {
+        err = std::string("setsockopt(PACKET_AUXDATA): ") + strerror(errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static double elapsed_ms(
+    std::chrono::steady_clock::time_point const from,
+    std::chrono::steady_clock::time_point const to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+void initialize_fds(int* fds, struct pollfd* pfd, PortId const numPorts) {
+    auto const start = std::chrono::steady_clock::now();
+
+    // ------------------------------------------------------------------
+    // Resolve all interfaces with one RTM_GETLINK dump
+    // ------------------------------------------------------------------
+    LinkTable links;
+    if (!netlink_dump_links(links)) {
+        std::cerr << "[DP] netlink link dump failed\n";
+    }
+    auto const resolved = std::chrono::steady_clock::now();
+
     // ------------------------------------------------------------------
-    // Open AF_PACKET sockets for veth0…vethN
+    // Open AF_PACKET sockets for the configured interfaces, in parallel
     // ------------------------------------------------------------------
-    for (int port = 0; port < NumSwitchPorts; port++) {
+    std::vector<std::string> errors(numPorts);
+    unsigned const numThreads = std::clamp<unsigned>(
+        (numPorts + PortsPerSetupThread - 1) / PortsPerSetupThread, 1, MaxSetupThreads);
+
+    auto const setup = [&](unsigned const first) {
+        for (PortId port = first; port < numPorts; port += numThreads) {
+            std::string const& ifname = g_switch_state.portSettings(port).ifname;
+            auto const it = links.find(ifname);
+            if (it == links.end()) {
+                fds[port] = -1;
+                errors[port] = "no such interface";
+                continue;
+            }
+            fds[port] = open_port_socket(it->second.ifindex, errors[port]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < numThreads; t++) {
+        threads.emplace_back(setup, t);
+    }
+    setup(0);
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    auto const opened = std::chrono::steady_clock::now();
 
-        fds[port] = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    // A port that cannot be opened is marked down; the switch runs
+    // without it.
+    PortId down = 0;
+    for (PortId port = 0; port < numPorts; port++) {
+        std::string const& ifname = g_switch_state.portSettings(port).ifname;
         if (fds[port] < 0) {
-            perror("socket");
-            exit(1);
+            pfd[port] = pollfd{-1, 0, 0};
+            g_switch_state.setPortOperUp(port, false);
+            std::cerr << "[DP] port=" << port << " " << ifname << ": "
+                      << errors[port] << ", marked down\n";
+            down++;
+            continue;
         }
 
-        std::string ifname = "veth" + std::to_string(port);
+        pfd[port].fd     = fds[port];
+        pfd[port].events = POLLIN;
 
-        int ifindex = if_nametoindex(ifname.c_str());
-        if (ifindex == 0) {
-            perror("if_nametoindex");
-            exit(1);
+        bool const up = links[ifname].operUp();
+        bool const provider = g_switch_state.portSettings(port).tpid == EthTypeQinQ;
+        PortId const lagPort = g_switch_state.lagPort(port);
+        g_switch_state.setPortIfindex(port, links[ifname].ifindex);
+        g_switch_state.setPortOperUp(port, up);
+        std::cout << "[DP] port=" << port
+                  << " bound to " << ifname << (provider ? " (802.1ad)" : "");
+        if (g_switch_state.isLag(lagPort)) {
+            std::cout << " (LAG " << lagPort << ")";
         }
+        std::cout << (up ? "" : " (link down)") << "\n";
+    }
+
+    ::printf("[DP] startup: link dump %.2f ms (%zu links), sockets %.2f ms (%u threads), "
+             "total %.2f ms, %u of %u ports down\n",
+        elapsed_ms(start, resolved), links.size(),
+        elapsed_ms(resolved, opened), numThreads,
+        elapsed_ms(start, opened), down, numPorts);
+}
+
+void pin_thread_to_cpu(int const cpu, char const* const name) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int const err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        std::cerr << "[DP] cannot pin " << name << " thread to cpu " << cpu
+                  << ": " << strerror(err) << "\n";
+        return;
+    }
+    std::cout << "[DP] " << name << " thread pinned to cpu " << cpu << "\n";
+}
+
+void clear_port_error(int const fd) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+}
+
+void enable_rx_timestamps(int const fd) {
+    int const on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+        perror("setsockopt(SO_TIMESTAMPNS)");
+    }
+}
+
+uint64_t rx_latency_ns(struct msghdr const& msg) {
+    for (cmsghdr const* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&msg), const_cast<cmsghdr*>(cmsg))) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS)
+            continue;
 
-        struct sockaddr_ll sll = {};
-        sll.sll_family   = AF_PACKET;
-        sll.sll_protocol = htons(ETH_P_ALL);
-        sll.sll_ifindex  = ifindex;
+        timespec stamp;
+        std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
 
-        if (bind(fds[port], reinterpret_cast<struct sockaddr*>(&sll), sizeof(sll)) < 0) {
-            perror("bind");
-            exit(1);
+        int64_t const ns = (now.tv_sec - stamp.tv_sec) * 1000000000L + (now.tv_nsec - stamp.tv_nsec);
+        return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    }
+    return 0;
+}
+
+ssize_t recv_port_frame(int const fd, PacketBuf& pkt, uint16_t const tpid, uint64_t* const rxLatencyNs) {
+    iovec iov{pkt.data, MaxFrameByteLen};
+    alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(tpacket_auxdata)) +
+                                     CMSG_SPACE(sizeof(timespec))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t const n = recvmsg(fd, &msg, MSG_DONTWAIT);
+    if (n < 2 * MacAddressByteLen + 2) {
+        return n;
+    }
+    pkt.len = static_cast<uint16_t>(n);
+
+    for (cmsghdr const* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, const_cast<cmsghdr*>(cmsg))) {
+        if (cmsg->cmsg_level != SOL_PACKET || cmsg->cmsg_type != PACKET_AUXDATA)
+            continue;
+
+        tpacket_auxdata aux;
+        std::memcpy(&aux, CMSG_DATA(cmsg), sizeof(aux));
+        if (aux.tp_status & TP_STATUS_VLAN_VALID) {
+            uint16_t const stripped =
+                (aux.tp_status & TP_STATUS_VLAN_TPID_VALID) ? aux.tp_vlan_tpid : uint16_t{EthTypeVlan};
+            pkt.pushVlanTag(stripped, aux.tp_vlan_tci);
         }
+    }
+    // A tag of another TPID, e.g. an S-tag on an 802.1Q port, is payload.
+    pkt.vlanTagged = extract_ethertype(pkt.data + 2 * MacAddressByteLen) == tpid;
 
-        pfd[port].fd     = fds[port];
-        pfd[port].events = POLLIN;
+    if (rxLatencyNs) {
+        *rxLatencyNs = rx_latency_ns(msg);
+    }
+    return pkt.len;
+}
 
-        std::cout << "[DP] port=" << port
-                  << " bound to " << ifname << "\n";
+// Time the kernel may spin on the device queue per receive call
+enum { SocketBusyPollUsecs = 50 };
+
+bool enable_socket_busy_poll(int const fd) {
+#ifdef SO_BUSY_POLL
+    int const usecs = SocketBusyPollUsecs;
+    return setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)) == 0;
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+enum {
+    BusyPollFdbEntries = 65536,        // FDB entries preallocated for busy polling
+    PrefaultStackBytes = 256 * 1024    // Stack touched before locking memory
+};
+
+// Touch the stack pages the dataplane may use, so that mlockall() maps them
+static void prefault_stack() {
+    volatile uint8_t stack[PrefaultStackBytes];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+void prepare_busy_poll(DataplaneConfig const& config) {
+    // The packet pool is populated when it is mapped; size the FDB up front,
+    // so that learning never reallocates it.
+    g_switch_state.reserveFdb(BusyPollFdbEntries);
+    prefault_stack();
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        perror("[DP] mlockall");
+    } else {
+        std::cout << "[DP] memory locked\n";
+    }
+
+    if (config.schedFifoPriority > 0) {
+        sched_param param = {};
+        param.sched_priority = static_cast<int>(config.schedFifoPriority);
+        int const err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            std::cerr << "[DP] cannot set SCHED_FIFO priority " << config.schedFifoPriority
+                      << ": " << strerror(err) << "\n";
+        } else {
+            std::cout << "[DP] SCHED_FIFO priority " << config.schedFifoPriority << "\n";
+        }
     }
 }
 
@@ -107,115 +366,189 @@ void logLearn(
         vlan, smacStr.data(), port);
 }
 
-void sendPacket(
-    int fd,
-    uint8_t const * const pktBuffer,
-    size_t const nbytes,
-    PortId const port,
-    MacAddress const dmac,
+void reportUnlearned(
+    VlanId const vlan,
     MacAddress const smac,
-    uint16_t const ethtype) {
+    PortId const port,
+    LearnMode const mode) {
 
-    send(fd, pktBuffer, nbytes, 0);
+    if (mode == LearnMode::Disable || !g_switch_state.reportMac(vlan, smac, port, mode)) {
+        return;
+    }
+    if (mode == LearnMode::CpuLog) {
+        MacString const smacStr = macToString(smac);
+        ::printf("[DP] unlearned vlan = %d, mac = %s at port = %d\n",
+            vlan, smacStr.data(), port);
+    }
+}
 
-    logPacket("  ", "Tx", port, dmac, smac, ethtype);
+// Sweep of the FDB on the aging timer; the sharded dataplane's workers age
+// their own FDB slices
+static void age_fdb(AgingTimer::Tick const now)
+{
+    size_t const aged = g_switch_state.ageFdb(now);
+    if (aged != 0) {
+        std::cout << "[DP] aged out " << aged << " FDB entries\n";
+    }
 }
 
-// Dataplane main loop
-void run_dataplane()
+// Sweep of the unlearned sources seen on the aging timer; also logs the
+// sources not reported because the table was full
+static void age_reported_macs(AgingTimer::Tick const now)
 {
-    int fds[NumSwitchPorts];
-    struct pollfd pfd[NumSwitchPorts];
+    static uint64_t overflowsLogged = 0;
+
+    g_switch_state.ageReportedMacs(now);
+    uint64_t const overflows = g_switch_state.reportOverflows();
+    if (overflows != overflowsLogged) {
+        std::cout << "[DP] " << overflows - overflowsLogged
+                  << " unlearned sources not reported, table full\n";
+        overflowsLogged = overflows;
+    }
+}
 
-    initialize_fds(fds, pfd);
+// Sweep of the multicast group table on the aging timer
+static void age_mcast(AgingTimer::Tick const now)
+{
+    size_t const expired = g_switch_state.ageMcast(now);
+    if (expired != 0) {
+        std::cout << "[DP] " << expired << " multicast memberships and router ports expired\n";
+    }
+}
 
-    // Frame buffer, reused.
-    uint8_t buf[MaxFrameByteLen];
+// Sweep of the ARP / ND neighbor table on the aging timer; also logs the
+// bindings dropped because the table was full
+static void age_neighbors(AgingTimer::Tick const now)
+{
+    static uint64_t overflowsLogged = 0;
 
-    ssize_t const minFrameLen = 2 * MacAddressByteLen + 2;
+    size_t const aged = g_switch_state.ageNeighbors(now);
+    if (aged != 0) {
+        std::cout << "[DP] aged out " << aged << " ARP / ND bindings\n";
+    }
+    uint64_t const overflows = g_switch_state.neighborOverflows();
+    if (overflows != overflowsLogged) {
+        std::cout << "[DP] " << overflows - overflowsLogged
+                  << " ARP / ND bindings not learned, table full\n";
+        overflowsLogged = overflows;
+    }
+}
 
-    // ------------------------------------------------------------------
-    // Dataplane Loop
-    // ------------------------------------------------------------------
-    for (;;) {
+// Pipeline flavour of this build target
+#ifndef SWITCH_PIPELINE
+#define SWITCH_PIPELINE StandardPipeline
+#endif
 
-        int ret = poll(pfd, NumSwitchPorts, 1000);
-        if (ret < 0) {
-            perror("poll");
-            continue;
-        }
-        if (ret == 0)
-            continue;
+typedef SWITCH_PIPELINE SelectedPipeline;
 
-        for (PortId port = 0; port < NumSwitchPorts; port++) {
-            if (!(pfd[port].revents & POLLIN))
-                continue;
+// Buffers the dataplane of config may hold at once on numPorts ports: full
+// TX queues of every port on every thread that sends to it, full rings
+// between threads, and a full cache and receive burst per thread; at least
+// PacketPoolSize. A pool this large never runs dry, so congested ports
+// cannot starve forwarding between the others.
+static uint32_t packet_pool_size(PortId const numPorts, DataplaneConfig const& config)
+{
+    size_t threads = 1;
+    size_t txQueues = numPorts;
+    size_t ringSlots = 0;
+    if (config.shards > 0) {
+        // Every worker has a TX queue per port, and a ring from every worker.
+        threads = config.shards;
+        txQueues = size_t{config.shards} * numPorts;
+        ringSlots = size_t{config.shards} * config.shards * ShardedDataplane::RingSize;
+    } else if (config.pipelined) {
+        threads = size_t{config.rxThreads} + config.txThreads + 1;
+        ringSlots = (size_t{config.rxThreads} + config.txThreads) *
+                    PipelinedDataplane<SelectedPipeline>::RingSize;
+    }
+    size_t const bufs = txQueues * TxQueueDepth + ringSlots +
+                        threads * (size_t{PacketPool::CacheSize} + IngressBurstMax);
+    return static_cast<uint32_t>(std::max<size_t>(bufs, PacketPoolSize));
+}
 
-            ssize_t const n = recv(fds[port], buf, sizeof(buf), 0);
-            if (n <= 0)
-                continue;
+// Run the dataplane core specialized for up to N ports
+template <PortId N>
+[[noreturn]] static void run_dataplane_core(
+    PortId const numPorts,
+    PacketPool& pool,
+    DataplaneConfig const& config,
+    LinkMonitor& linkMonitor)
+{
+    std::cout << "[DP] " << numPorts << " ports, using ";
+    if constexpr (N == DynamicPortCount) {
+        std::cout << "generic dataplane core\n";
+    } else {
+        std::cout << "dataplane core for up to " << N << " ports\n";
+    }
 
-            if (n < minFrameLen)
-                continue;
+    DataplaneCore<N, SelectedPipeline> core(numPorts, pool, config, linkMonitor);
+    linkMonitor.start();
+    core.run();
+}
 
-            MacAddress const dmac = extract_mac(buf);
-            MacAddress const smac = extract_mac(buf + MacAddressByteLen);
-            uint16_t const ethtype = extract_ethertype(buf + 2 * MacAddressByteLen);
+// Dataplane main loop
+void run_dataplane(DataplaneConfig const& config)
+{
+    PortId const numPorts = static_cast<PortId>(g_switch_state.numPorts());
 
-            logPacket("\n", "Rx", port, dmac, smac, ethtype);
+    PacketPool pool(packet_pool_size(numPorts, config));
+    std::cout << "[DP] " << pool.tostring();
 
-            // For this project, skip IPv6 packets for now.
-            if (ethtype == ETH_P_IPV6) {
-                continue;
-            }
+    // The aging sweeps run at the default scheduling policy.
+    g_aging_timer.every(1, age_fdb);
+    g_aging_timer.every(1, age_reported_macs);
+    g_aging_timer.every(1, age_mcast);
+    g_aging_timer.every(1, age_neighbors);
+    g_aging_timer.start();
 
-            // Determine VLAN via PVID
-            VlanId vlan;
-            bool const portVlanConfigured = g_switch_state.getPortPvid(port, vlan);
-            // If the port has no VLAN configured, then user default VLAN.
-            if (!portVlanConfigured) {
-                vlan = DefaultVlanId;
-            }
+    // Threads started from here on inherit the scheduling policy.
+    if (config.busyPoll) {
+        prepare_busy_poll(config);
+    }
 
-            // Learn source MAC
-            auto const [learned, moved] = g_switch_state.learnMac(vlan, smac, port);
-            bool const learned_or_moved = learned || moved;
-            if (learned_or_moved) {
-                logLearn(vlan, smac, port);
-            }
+    // Only the run-to-completion core attaches interfaces that appear
+    // while the switch runs.
+    bool const hotAttach = config.shards == 0 && !config.pipelined && !config.vectorMode;
+    LinkMonitor linkMonitor(hotAttach);
 
-            // Lookup destination MAC
-            PortId out;
-            bool const found = g_switch_state.lookupFdb(vlan, dmac, out);
-
-            if (found && out != port) {
-                // Unicast
-                sendPacket(fds[out], buf, n, out, dmac, smac, ethtype);
-            } else {
-                // Flood inside VLAN
-                VlanMemberList members;
-                if (!g_switch_state.getVlanMembers(vlan, members)) {
-                    // No VLAN config, flood to ALL ports except ingress port
-                    for (PortId p = 0; p < NumSwitchPorts; p++) {
-                        if (p != port) {
-                            sendPacket(fds[p], buf, n, p, dmac, smac, ethtype);
-                        }
-                    }
-                } else {
-                    // Flood to remaining ports of this vlan
-                    for (PortId p : members) {
-                        if (p != port) {
-                            sendPacket(fds[p], buf, n, p, dmac, smac, ethtype);
-                        }
-                    }
-                }
-            }
+    if (config.shards > 0) {
+        ShardedDataplane shardedDataplane(numPorts, pool, config);
+        linkMonitor.start();
+        shardedDataplane.run();
+    }
 
-            if (learned_or_moved) {
-                auto const fdbString = g_switch_state.tostringFdb();
-                std::cout << "== Current FDB ==\n";
-                std::cout << fdbString << std::endl;
-            }
+    if (config.pipelined) {
+        PipelinedDataplane<SelectedPipeline> pipelinedDataplane(numPorts, pool, config);
+        linkMonitor.start();
+        pipelinedDataplane.run();
+    }
+
+    if (!config.cpus.empty()) {
+        pin_thread_to_cpu(config.cpus[0], "dataplane");
+    }
+
+    if (config.vectorMode) {
+        std::cout << "[DP] " << numPorts << " ports, using vector dataplane\n";
+        VectorDataplane vectorDataplane(numPorts, pool, config);
+        linkMonitor.start();
+        vectorDataplane.run();
+    }
+
+    // Pick the smallest port-count specialization that fits.
+    if (!config.genericDataplane) {
+        if (numPorts <= 4) {
+            run_dataplane_core<4>(numPorts, pool, config, linkMonitor);
+        }
+        if (numPorts <= 8) {
+            run_dataplane_core<8>(numPorts, pool, config, linkMonitor);
+        }
+        if (numPorts <= 32) {
+            run_dataplane_core<32>(numPorts, pool, config, linkMonitor);
+        }
+        if (numPorts <= 64) {
+            run_dataplane_core<64>(numPorts, pool, config, linkMonitor);
         }
     }
+
+    run_dataplane_core<DynamicPortCount>(numPorts, pool, config, linkMonitor);
 }
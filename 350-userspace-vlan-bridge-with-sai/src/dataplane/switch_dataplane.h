@@ -0,0 +1,134 @@
+#pragma once
+
+#include "switch_state.h"
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct msghdr;
+struct pollfd;
+struct PacketBuf;
+
+// -----------------------------------------------------------------------------
+// Dataplane run-time options, set from the command line
+// -----------------------------------------------------------------------------
+struct DataplaneConfig {
+    // Use the generic core even if a port-count specialization fits
+    bool genericDataplane = false;
+
+    // Process frames in vectors through a node graph (vector_dataplane.h)
+    bool vectorMode = false;
+
+    // Port → ingress scheduler weight (ingress_scheduler.h); ports past
+    // the end weigh 1
+    std::vector<uint32_t> portWeights;
+
+    // Run RX, forwarding, and TX on separate threads (pipelined_dataplane.h)
+    bool     pipelined = false;
+    uint32_t rxThreads = 1;
+    uint32_t txThreads = 1;
+
+    // Spin on the ports instead of sleeping in poll() (run-to-completion
+    // core), with all memory locked and the tables prefaulted
+    bool busyPoll = false;
+
+    // SCHED_FIFO priority of the dataplane threads with busyPoll; 0 keeps
+    // the default policy
+    uint32_t schedFifoPriority = 0;
+
+    // Spin while frames flow, nap when they pause, and block in poll()
+    // after adaptiveIdleUsecs without frames (run-to-completion core;
+    // poll_governor.h)
+    bool     adaptivePoll = false;
+    uint32_t adaptiveIdleUsecs = 1000;
+
+    // Run this many shared-nothing workers, each owning a slice of the FDB
+    // (sharded_dataplane.h); 0 is off
+    uint32_t shards = 0;
+
+    // Cores to pin the dataplane threads to, in thread order; the
+    // run-to-completion dataplane uses the first one, the sharded
+    // dataplane one per worker
+    std::vector<int> cpus;
+};
+
+// Dataplane thread entry point
+void run_dataplane(DataplaneConfig const& config);
+
+// -----------------------------------------------------------------------------
+// Helpers shared by the dataplane cores
+// -----------------------------------------------------------------------------
+
+// Open and bind one AF_PACKET socket per port. Interfaces are resolved
+// with one netlink dump and the sockets opened by parallel threads. A port
+// that fails gets fd -1 and is marked down.
+void initialize_fds(int* fds, struct pollfd* pfd, PortId numPorts);
+
+// Open and bind the non-blocking AF_PACKET socket of an interface; on
+// failure, set err and return -1
+int open_port_socket(int ifindex, std::string& err);
+
+// Pin the calling thread to cpu; name is for the log
+void pin_thread_to_cpu(int cpu, char const* name);
+
+// Read and clear the pending error of a port socket, e.g. ENETDOWN after
+// its link went down, which poll() otherwise keeps reporting as POLLERR
+void clear_port_error(int fd);
+
+// Enable kernel receive timestamps (SO_TIMESTAMPNS) on a port socket
+void enable_rx_timestamps(int fd);
+
+// Nanoseconds from the kernel receive timestamp in the control data of
+// msg to now; 0 if msg carries none
+uint64_t rx_latency_ns(struct msghdr const& msg);
+
+// Receive one frame from port socket fd into pkt and set its length and
+// tagging: the frame is tagged if its outer tag has tpid, the TPID of the
+// port. A VLAN tag the kernel stripped (PACKET_AUXDATA) is pushed back
+// into the frame. If rxLatencyNs is given, it receives the latency since
+// the kernel receive timestamp (0 without one). Return the frame length,
+// or the result of recvmsg() if that is short of an Ethernet header.
+ssize_t recv_port_frame(int fd, PacketBuf& pkt, uint16_t tpid, uint64_t* rxLatencyNs = nullptr);
+
+// Ask the kernel to busy poll the device queue on receive
+// (SO_BUSY_POLL); false where unsupported
+bool enable_socket_busy_poll(int fd);
+
+// Prepare the process for busy polling: preallocate the FDB, prefault the
+// stack, lock all memory, and switch to SCHED_FIFO if configured
+void prepare_busy_poll(DataplaneConfig const& config);
+
+// Ethertype of the payload of frame, behind up to two VLAN tags
+uint16_t extract_payload_ethertype(uint8_t const* frame);
+
+// Flow hash of frame, of len bytes, that picks the egress member of a LAG:
+// of the MACs, plus for IPv4 the addresses and protocol, plus for TCP and
+// UDP the ports. Tags do not change the hash, so a frame hashes the same
+// before and after its tag is pushed or popped.
+uint32_t flow_hash(uint8_t const* frame, size_t len);
+
+void logPacket(
+    char const * const indent,
+    char const * const type,
+    PortId const port,
+    MacAddress const dmac,
+    MacAddress const smac,
+    uint16_t const ethtype);
+
+void logLearn(
+    VlanId const vlan,
+    MacAddress const smac,
+    PortId const port);
+
+// Handle the source MAC of a frame that is not learned because of its
+// learning mode: a new source is logged (LearnMode::CpuLog) or reported to
+// the management plane (LearnMode::Notify)
+void reportUnlearned(
+    VlanId const vlan,
+    MacAddress const smac,
+    PortId const port,
+    LearnMode const mode);
@@ -0,0 +1,57 @@
+#include "tx_queue.h"
+
+#include <sys/socket.h>
+
+#include <cerrno>
+
+static_assert((TxQueueDepth & (TxQueueDepth - 1)) == 0, "TxQueueDepth must be a power of two");
+
+// -----------------------------------------------------------------------------
+bool TxQueue::send(int const fd, PacketBuf& pkt, uint16_t const tci, PortStats& stats) const
+{
+    pkt.setVlanTag(tpid_, tci);
+    if (::send(fd, pkt.data, pkt.len, MSG_DONTWAIT) >= 0) {
+        stats.txFrames++;
+        return true;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+        return false;
+    }
+    // Port down or gone; the frame is lost.
+    stats.txDrops++;
+    return true;
+}
+
+void TxQueue::transmit(int const fd, PacketBuf* const pkt, uint16_t const tci, PortStats& stats)
+{
+    // Keep frame order: never overtake queued frames.
+    if (count_ == 0 && send(fd, *pkt, tci, stats)) {
+        return;
+    }
+
+    if (count_ == TxQueueDepth) {
+        stats.txDrops++;
+        return;
+    }
+
+    PacketPool::ref(pkt);
+    ring_[(head_ + count_) & (TxQueueDepth - 1)] = Entry{pkt, tci};
+    count_++;
+    if (count_ > stats.txQueueMax) {
+        stats.txQueueMax = count_;
+    }
+}
+
+void TxQueue::flush(int const fd, PacketPool& pool, PacketPool::Cache& cache, PortStats& stats)
+{
+    while (count_ != 0) {
+        Entry const& entry = ring_[head_];
+        stats.txRetries++;
+        if (!send(fd, *entry.pkt, entry.tci, stats)) {
+            return;
+        }
+        pool.release(cache, entry.pkt);
+        head_ = (head_ + 1) & (TxQueueDepth - 1);
+        count_--;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "packet_pool.h"
+#include "dataplane_stats.h"
+
+#include <array>
+#include <cstdint>
+
+enum {
+    // Frames a port queues while its socket is busy; power of two
+    TxQueueDepth = 256
+};
+
+// -----------------------------------------------------------------------------
+// TxQueue: bounded egress queue of one port.
+//
+// Port sockets are non-blocking. A frame is sent right away when nothing is
+// queued; if the socket is busy (EAGAIN/ENOBUFS), it is queued instead and
+// the owner polls the port for POLLOUT, then calls flush(). When the queue
+// is full the frame is dropped, so a congested or down port never holds up
+// forwarding between the other ports.
+//
+// Queued frames hold a reference to their buffer. Each frame carries the
+// TCI it leaves the port with, and gets its tag, of the port's TPID, right
+// before it is sent (PacketBuf::setVlanTag()), so a buffer queued to
+// several ports may leave each one tagged differently. The tag is changed
+// in place, so all queues holding a buffer must be served by the same
+// thread.
+// -----------------------------------------------------------------------------
+class TxQueue {
+public:
+    // Set the TPID of the tags frames get on this port (default 0x8100)
+    void setTpid(uint16_t const tpid) { tpid_ = tpid; }
+
+    // Send pkt to socket fd with VLAN tag tci (untagged if 0), or queue
+    // it behind earlier frames. The caller keeps its own reference to pkt.
+    void transmit(int fd, PacketBuf* pkt, uint16_t tci, PortStats& stats);
+
+    // Send queued frames until the socket is busy again; the sent frames'
+    // references are released to cache
+    void flush(int fd, PacketPool& pool, PacketPool::Cache& cache, PortStats& stats);
+
+    // Queued frames
+    uint32_t size() const { return count_; }
+
+    bool empty() const { return count_ == 0; }
+
+private:
+    // Queued frame
+    struct Entry {
+        PacketBuf* pkt;
+        uint16_t   tci;   // Egress VLAN tag; 0 for untagged
+    };
+
+    // Send one frame; false if the socket is busy
+    bool send(int fd, PacketBuf& pkt, uint16_t tci, PortStats& stats) const;
+
+private:
+    std::array<Entry, TxQueueDepth>      ring_;
+    uint32_t                             head_ = 0;   // Oldest frame
+    uint32_t                             count_ = 0;
+    uint16_t                             tpid_ = EthTypeVlan;
+};
@@ -0,0 +1,420 @@
+#include "vector_dataplane.h"
+#include "switch_dataplane.h"
+#include "arp_suppression.h"
+#include "mcast_snooping.h"
+#include "cycles.h"
+
+#include <sys/socket.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+
+static char const * const NodeNames[] = {
+    "ethernet-input",
+    "vlan-classify",
+    "l2-learn",
+    "l2-fwd",
+    "l2-flood",
+    "port-tx"
+};
+
+// -----------------------------------------------------------------------------
+VectorDataplane::VectorDataplane(
+    PortId const numPorts,
+    PacketPool& pool,
+    DataplaneConfig const& config)
+    : numPorts_{numPorts},
+      fds_(numPorts),
+      pfd_(numPorts),
+      portStats_(numPorts),
+      txq_(numPorts),
+      ingress_{numPorts, config.portWeights},
+      storm_{numPorts},
+      pool_{pool},
+      cache_{pool}
+{
+    // Every frame may be flooded to all other ports.
+    tx_.reserve(size_t{VectorSize} * numPorts_);
+
+    for (PortId port = 0; port < numPorts_; port++) {
+        txq_[port].setTpid(g_switch_state.portSettings(port).tpid);
+    }
+
+    initialize_fds(fds_.data(), pfd_.data(), numPorts_);
+
+    std::cout << "[DP] header parser: " << header_parser_name() << std::endl;
+}
+
+void VectorDataplane::run()
+{
+    // ------------------------------------------------------------------
+    // Dataplane Loop
+    // ------------------------------------------------------------------
+    for (;;) {
+
+        int ret = poll(pfd_.data(), numPorts_, 1000);
+        if (ret < 0) {
+            perror("poll");
+            continue;
+        }
+        if (ret == 0) {
+            dumpStats();
+            continue;
+        }
+
+        flushTx();
+
+        uint16_t const count = receiveVector();
+        if (count == 0)
+            continue;
+
+        for (uint16_t i = 0; i < count; i++) {
+            queues_[EthernetInput].push(i);
+        }
+
+        runNode(EthernetInput, [this] { ethernetInput(); });
+        runNode(VlanClassify,  [this] { vlanClassify(); });
+        runNode(L2Learn,       [this] { l2Learn(); });
+        runNode(L2Fwd,         [this] { l2Fwd(); });
+        runNode(L2Flood,       [this] { l2Flood(); });
+        runNode(PortTx,        [this] { portTx(); });
+
+        // Drop the receive references; sent and dropped frames go back
+        // to the pool.
+        for (uint16_t i = 0; i < count; i++) {
+            pool_.release(cache_, pkts_[i]);
+        }
+    }
+}
+
+uint16_t VectorDataplane::receiveVector()
+{
+    ssize_t const minFrameLen = 2 * MacAddressByteLen + 2;
+
+    // The ingress scheduler shares the vector among the ready ports, so
+    // that a busy port cannot fill the whole vector while others wait.
+    uint16_t count = 0;
+    ingress_.serve(pfd_.data(), VectorSize, portStats_.data(), [&](PortId const port) {
+        // On exhaustion, leave the frames in the sockets for later.
+        PacketBuf* const pkt = pool_.alloc(cache_);
+        if (!pkt)
+            return false;
+
+        ssize_t const n = recv_port_frame(fds_[port], *pkt, g_switch_state.portSettings(port).tpid);
+        if (n < minFrameLen) {
+            pool_.release(cache_, pkt);
+            // Drained, or a runt frame
+            return n >= 0;
+        }
+
+        pkt->port = port;
+        pkts_[count] = pkt;
+        port_[count] = port;
+        portStats_[port].rxFrames++;
+        count++;
+        return true;
+    });
+    return count;
+}
+
+template <typename Fn>
+void VectorDataplane::runNode(NodeId const node, Fn&& fn)
+{
+    NodeStats& nodeStats = nodeStats_[node];
+    uint64_t const frames = (node == PortTx) ? tx_.size() : queues_[node].count;
+    if (frames == 0) {
+        return;
+    }
+
+    uint64_t const start = read_cycles();
+    fn();
+    uint64_t const cycles = read_cycles() - start;
+
+    nodeStats.calls++;
+    nodeStats.frames += frames;
+    nodeStats.cycles += cycles;
+    stats_.procCycles += cycles;
+}
+
+// Parse the Ethernet headers and classify the dmac
+void VectorDataplane::ethernetInput()
+{
+    NodeQueue& in = queues_[EthernetInput];
+    NodeQueue& next = queues_[VlanClassify];
+
+    // The input queue is the whole received vector, in order, so the
+    // burst parser output is indexed by frame.
+    for (uint16_t k = 0; k < in.count; k++) {
+        framePtrs_[k] = frame(in.frames[k]);
+    }
+    parse_headers(framePtrs_.data(), in.count, headers_);
+
+    for (uint16_t k = 0; k < in.count; k++) {
+        uint16_t const i = in.frames[k];
+        dmacClass_[i] = classify_mac(headers_.dmac[i]);
+        stats_.countRx(dmacClass_[i]);
+        next.push(i);
+    }
+    in.count = 0;
+}
+
+// Determine VLAN via the outer tag or PVID; drop tagged frames of VLANs the
+// ingress port is not a member of
+void VectorDataplane::vlanClassify()
+{
+    NodeQueue& in = queues_[VlanClassify];
+    NodeQueue& next = queues_[L2Learn];
+
+    for (uint16_t k = 0; k < in.count; k++) {
+        uint16_t const i = in.frames[k];
+        // The parser reports any outer tag; the frame is tagged only if it
+        // has the TPID of the ingress port.
+        bool const tagged = pkts_[i]->vlanTagged;
+        VlanId const vid = tagged ? (headers_.tci[i] & VlanIdMask) : 0;
+        if (!g_switch_state.classifyVlan(port_[i], tagged, vid, vlan_[i], learn_[i])) {
+            stats_.vlanDrops++;
+            continue;
+        }
+        tci_[i] = pkts_[i]->egressTci(vlan_[i]);
+        next.push(i);
+    }
+    in.count = 0;
+}
+
+// Learn source MAC, unless the learning mode of the port and VLAN says
+// otherwise
+void VectorDataplane::l2Learn()
+{
+    NodeQueue& in = queues_[L2Learn];
+    NodeQueue& next = queues_[L2Fwd];
+
+    for (uint16_t k = 0; k < in.count; k++) {
+        uint16_t const i = in.frames[k];
+        next.push(i);
+        if (learn_[i] != LearnMode::Hardware) {
+            reportUnlearned(vlan_[i], headers_.smac[i], port_[i], learn_[i]);
+            continue;
+        }
+        auto const [learned, moved] = g_switch_state.learnMac(vlan_[i], headers_.smac[i], port_[i],
+                                                              g_aging_timer.now());
+        if (learned || moved) {
+            logLearn(vlan_[i], headers_.smac[i], port_[i]);
+        }
+    }
+    in.count = 0;
+}
+
+// Forward unicast frames found in FDB; everything else goes to l2-flood.
+// Multicast frames get the egress ports IGMP / MLD snooping allows, and
+// their membership messages are punted to snooping.
+void VectorDataplane::l2Fwd()
+{
+    NodeQueue& in = queues_[L2Fwd];
+    NodeQueue& flood = queues_[L2Flood];
+
+    // Broadcast and multicast frames go straight to flooding,
+    // only unicast destination MACs are looked up in FDB, as one
+    // batch so that their bucket loads overlap. ARP / ND requests
+    // for a bound target are looked up under the owner's MAC.
+    uint16_t numKeys = 0;
+    for (uint16_t k = 0; k < in.count; k++) {
+        uint16_t const i = in.frames[k];
+        mcastPorts_[i] = AllPortsBitmap;
+        lookedUp_[i] = false;
+
+        MacAddress owner = 0;
+        NeighLookup neigh = NeighLookup::None;
+        if (is_arp_nd_ethertype(headers_.ethtype[i])) {
+            neigh = arp_nd_snoop(vlan_[i], learn_[i], headers_.ethtype[i], pkts_[i]->data,
+                                 pkts_[i]->len, owner);
+            stats_.neighHits += (neigh == NeighLookup::Hit);
+            stats_.neighMisses += (neigh == NeighLookup::Miss);
+        }
+
+        if (neigh == NeighLookup::Hit) {
+            lookupKeys_[numKeys] = FdbLookupKey{vlan_[i], owner};
+            lookedUp_[i] = true;
+            numKeys++;
+        } else if (dmacClass_[i] == MacClass::Unicast) {
+            lookupKeys_[numKeys] = FdbLookupKey{vlan_[i], headers_.dmac[i]};
+            lookedUp_[i] = true;
+            numKeys++;
+        } else if (dmacClass_[i] == MacClass::Multicast) {
+            McastControl control;
+            mcastPorts_[i] = mcast_egress_ports(vlan_[i], port_[i], pkts_[i]->data,
+                                                pkts_[i]->len, control);
+            if (control != McastControl::None) {
+                stats_.mcastSnooped++;
+            }
+        }
+    }
+    g_switch_state.lookupFdbBatch(lookupKeys_.data(), numKeys, lookupPorts_.data(),
+                                  lookupFound_.data(), lookupTagged_.data());
+
+    uint16_t key = 0;
+    for (uint16_t k = 0; k < in.count; k++) {
+        uint16_t const i = in.frames[k];
+
+        bool found = false;
+        PortId out = 0;
+        bool tagged = false;
+        if (lookedUp_[i]) {
+            found = lookupFound_[key];
+            out = lookupPorts_[key];
+            tagged = found && lookupTagged_[key];
+            key++;
+        }
+
+        if (found && out != g_switch_state.lagPort(port_[i])) {
+            stats_.fwdUnicast++;
+            if (g_switch_state.isLag(out)) {
+                out = g_switch_state.lagMember(out, flow_hash(pkts_[i]->data, pkts_[i]->len));
+            }
+            PacketPool::ref(pkts_[i]);
+            tx_.push_back(TxEntry{i, out, static_cast<uint16_t>(tagged ? tci_[i] : 0)});
+        } else {
+            flood.push(i);
+        }
+    }
+    in.count = 0;
+}
+
+// Flood inside VLAN using the precomputed egress sets, to the ports snooping
+// allows; drop floods over the storm control limit of the ingress port
+void VectorDataplane::l2Flood()
+{
+    NodeQueue& in = queues_[L2Flood];
+
+    // Frames of a vector mostly share a VLAN, so keep the last flood sets.
+    VlanFloodSetsPtr floodSets;
+    VlanId floodSetsVlan = 0;
+
+    bool const storm = storm_.enabled() && in.count != 0;
+    uint64_t const now = storm ? StormControl::nowNs() : 0;
+
+    for (uint16_t k = 0; k < in.count; k++) {
+        uint16_t const i = in.frames[k];
+
+        if (storm && !storm_.admit(port_[i], dmacClass_[i], pkts_[i]->len, now)) {
+            portStats_[port_[i]].countStormDrop(dmacClass_[i]);
+            continue;
+        }
+
+        PortBitmap const allowed = mcastPorts_[i];
+        if (dmacClass_[i] == MacClass::Unicast) {
+            stats_.floodUnknown++;
+        } else if (allowed != AllPortsBitmap) {
+            stats_.fwdMulticast++;
+        } else {
+            stats_.floodGroup++;
+        }
+
+        if (!floodSets || floodSetsVlan != vlan_[i]) {
+            floodSets = g_switch_state.getFloodSets(vlan_[i]);
+            floodSetsVlan = vlan_[i];
+        }
+        // One reference per copy; the frame itself is not copied. The
+        // ports that take it with its current tagging go first, so that
+        // port-tx changes its tag at most once.
+        FloodSet const& floodSet = (*floodSets)[port_[i]];
+        bool const tagged = pkts_[i]->vlanTagged;
+        std::vector<PortId> const& first = tagged ? floodSet.tagged.ports : floodSet.untagged.ports;
+        std::vector<PortId> const& second = tagged ? floodSet.untagged.ports : floodSet.tagged.ports;
+        uint16_t const firstTci = tagged ? tci_[i] : 0;
+        uint16_t const secondTci = tagged ? 0 : tci_[i];
+
+        // A LAG port is sent to through the member of the frame's flow.
+        bool hashed = false;
+        uint32_t hash = 0;
+        auto const member = [&](PortId const p) {
+            if (!g_switch_state.isLag(p)) {
+                return p;
+            }
+            if (!hashed) {
+                hash = flow_hash(pkts_[i]->data, pkts_[i]->len);
+                hashed = true;
+            }
+            return g_switch_state.lagMember(p, hash);
+        };
+        size_t const queued = tx_.size();
+        for (PortId p : first) {
+            if (bitmap_has_port(allowed, p)) {
+                tx_.push_back(TxEntry{i, member(p), firstTci});
+            }
+        }
+        for (PortId p : second) {
+            if (bitmap_has_port(allowed, p)) {
+                tx_.push_back(TxEntry{i, member(p), secondTci});
+            }
+        }
+        PacketPool::ref(pkts_[i], static_cast<uint32_t>(tx_.size() - queued));
+    }
+    in.count = 0;
+}
+
+// Send scheduled frames
+void VectorDataplane::portTx()
+{
+    for (size_t k = 0; k < tx_.size(); k++) {
+        TxEntry const& entry = tx_[k];
+        if (k + 1 < tx_.size()) {
+            __builtin_prefetch(frame(tx_[k + 1].frame));
+        }
+        PacketBuf* const pkt = pkts_[entry.frame];
+        TxQueue& txq = txq_[entry.port];
+        txq.transmit(fds_[entry.port], pkt, entry.tci, portStats_[entry.port]);
+        if (!txq.empty()) {
+            pfd_[entry.port].events |= POLLOUT;
+        }
+        pool_.release(cache_, pkt);
+    }
+    tx_.clear();
+}
+
+void VectorDataplane::flushTx()
+{
+    for (PortId port = 0; port < numPorts_; port++) {
+        if (pfd_[port].revents & POLLERR)
+            clear_port_error(fds_[port]);
+
+        if (!(pfd_[port].revents & POLLOUT))
+            continue;
+
+        TxQueue& txq = txq_[port];
+        txq.flush(fds_[port], pool_, cache_, portStats_[port]);
+        if (txq.empty()) {
+            pfd_[port].events = POLLIN;
+        }
+    }
+}
+
+void VectorDataplane::dumpStats()
+{
+    // Idle; dump the counters if they moved since the last dump.
+    if (stats_.rxFrames() == rxFramesDumped_) {
+        return;
+    }
+    rxFramesDumped_ = stats_.rxFrames();
+
+    std::cout << "== Dataplane Stats ==\n";
+    std::cout << stats_.tostring();
+    size_t queued = 0;
+    for (PortId port = 0; port < numPorts_; port++) {
+        std::cout << portStats_[port].tostring(port, txq_[port].size());
+        queued += txq_[port].size();
+    }
+    std::cout << tostring_lag_stats(portStats_);
+    std::cout << g_switch_state.tostringMcast();
+    for (int node = 0; node < NumNodes; node++) {
+        NodeStats const& ns = nodeStats_[node];
+        ::printf("node %-14s vectors=%" PRIu64 " frames=%" PRIu64 " cycles/frame=%" PRIu64 "\n",
+            NodeNames[node], ns.calls, ns.frames,
+            ns.frames ? ns.cycles / ns.frames : 0);
+    }
+    std::cout << pool_.tostring();
+    std::cout << std::endl;
+
+    // Only the TX queues hold frames between vectors.
+    pool_.checkLeaks(queued);
+}
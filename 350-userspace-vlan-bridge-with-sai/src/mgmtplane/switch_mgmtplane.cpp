@@ -9,10 +9,12 @@
 
 sai_switch_api_t* g_switch_api = nullptr;
 sai_vlan_api_t*   g_vlan_api   = nullptr;
+sai_bridge_api_t* g_bridge_api = nullptr;
 sai_object_id_t   g_switch_id  = SAI_NULL_OBJECT_ID;
 
 constexpr std::size_t kMacStringLen = 18;
 constexpr uint16_t kVlan73 = 73;
+constexpr uint32_t kFdbAgingSecs = 300;
 
 static inline void
 mac_to_string(const sai_mac_t mac, char* buf)
@@ -33,6 +35,20 @@ event_to_string(sai_fdb_event_t const event)
     }
 }
 
+static inline char const *
+learning_mode_to_string(sai_bridge_port_fdb_learning_mode_t const mode)
+{
+    switch (mode) {
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_DROP: return "DROP";
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_DISABLE: return "DISABLE";
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_HW: return "HW";
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_CPU_TRAP: return "CPU_TRAP";
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_CPU_LOG: return "CPU_LOG";
+        case SAI_BRIDGE_PORT_FDB_LEARNING_MODE_FDB_NOTIFICATION: return "FDB_NOTIFICATION";
+        default: return "UNKNOWN";
+    }
+}
+
 static void
 on_fdb_event(uint32_t count, sai_fdb_event_notification_data_t const * const data)
 {
@@ -107,6 +123,12 @@ init_api_pointers()
     } else {
         std::cerr << "[MGMT] Failed to query VLAN API\n";
     }
+
+    if (sai_api_query(SAI_API_BRIDGE, reinterpret_cast<void**>(&g_bridge_api)) == SAI_STATUS_SUCCESS) {
+        std::cout << "[MGMT] BRIDGE API ready\n";
+    } else {
+        std::cerr << "[MGMT] Failed to query BRIDGE API\n";
+    }
 }
 
 static void
@@ -115,11 +137,14 @@ init_switch()
     assert(g_switch_api);
     assert(g_switch_api->create_switch);
 
-    sai_attribute_t attr{};
-    attr.id = SAI_SWITCH_ATTR_FDB_EVENT_NOTIFY;
-    attr.value.ptr = reinterpret_cast<void*>(on_fdb_event);
+    sai_attribute_t attrs[2]{};
+    attrs[0].id = SAI_SWITCH_ATTR_FDB_EVENT_NOTIFY;
+    attrs[0].value.ptr = reinterpret_cast<void*>(on_fdb_event);
+
+    attrs[1].id = SAI_SWITCH_ATTR_FDB_AGING_TIME;
+    attrs[1].value.u32 = kFdbAgingSecs;
 
-    sai_status_t rc = g_switch_api->create_switch(&g_switch_id, 1, &attr);
+    sai_status_t rc = g_switch_api->create_switch(&g_switch_id, 2, attrs);
     if (rc == SAI_STATUS_SUCCESS) {
         std::cout << "[MGMT] Switch created, switch_id = " << std::hex << g_switch_id << std::dec << "\n";
     } else {
@@ -149,7 +174,8 @@ create_vlan(uint16_t const vlan_id)
 static void
 create_vlan_member(
     sai_object_id_t const vlan_object_id,
-    uint16_t const port_id
+    uint16_t const port_id,
+    bool const tagged
 )
 {
     sai_attribute_t attrs[3]{};
@@ -161,13 +187,13 @@ create_vlan_member(
     attrs[1].value.oid = libsai_encode(ResourceType::BridgePort, port_id);
 
     attrs[2].id = SAI_VLAN_MEMBER_ATTR_VLAN_TAGGING_MODE;
-    attrs[2].value.s32 = SAI_VLAN_TAGGING_MODE_UNTAGGED;
+    attrs[2].value.s32 = tagged ? SAI_VLAN_TAGGING_MODE_TAGGED : SAI_VLAN_TAGGING_MODE_UNTAGGED;
 
     sai_object_id_t member_oid = SAI_NULL_OBJECT_ID;
     sai_status_t rc = g_vlan_api->create_vlan_member(&member_oid, g_switch_id, 3, attrs);
     if (rc == SAI_STATUS_SUCCESS) {
         std::cout << "[MGMT] VLAN member added: port " << port_id
-                  << " -> vlan " << kVlan73
+                  << " -> vlan " << kVlan73 << (tagged ? " tagged" : "")
                   << ", member_oid = " << std::hex << member_oid << std::dec << "\n";
     } else {
         std::cerr << "[MGMT] Failed to add port " << port_id
@@ -176,6 +202,27 @@ create_vlan_member(
     }
 }
 
+static void
+set_port_learning_mode(
+    uint16_t const port_id,
+    sai_bridge_port_fdb_learning_mode_t const mode
+)
+{
+    sai_attribute_t attr{};
+    attr.id = SAI_BRIDGE_PORT_ATTR_FDB_LEARNING_MODE;
+    attr.value.s32 = mode;
+
+    sai_object_id_t const bridge_port_oid = libsai_encode(ResourceType::BridgePort, port_id);
+    sai_status_t rc = g_bridge_api->set_bridge_port_attribute(bridge_port_oid, &attr);
+    if (rc == SAI_STATUS_SUCCESS) {
+        std::cout << "[MGMT] Port " << port_id << " FDB learning mode = "
+                  << learning_mode_to_string(mode) << "\n";
+    } else {
+        std::cerr << "[MGMT] Failed to set FDB learning mode of port " << port_id
+                  << ", status = " << rc << "\n";
+    }
+}
+
 static void
 init_mgmtplane()
 {
@@ -185,9 +232,16 @@ init_mgmtplane()
 
     sai_object_id_t const vlan73_object_id = create_vlan(kVlan73);
 
-    create_vlan_member(vlan73_object_id, 0);
-    create_vlan_member(vlan73_object_id, 1);
-    create_vlan_member(vlan73_object_id, 3);
+    create_vlan_member(vlan73_object_id, 0, false);
+    create_vlan_member(vlan73_object_id, 1, false);
+    create_vlan_member(vlan73_object_id, 2, true);
+    create_vlan_member(vlan73_object_id, 3, false);
+
+    // Learn in the FDB on every member; HW is also the default, but the
+    // management plane states it rather than rely on it.
+    for (uint16_t port_id = 0; port_id < 4; ++port_id) {
+        set_port_learning_mode(port_id, SAI_BRIDGE_PORT_FDB_LEARNING_MODE_HW);
+    }
 }
 
 void
@@ -0,0 +1,39 @@
+#include "aging_timer.h"
+
+#include <chrono>
+#include <thread>
+#include <utility>
+
+AgingTimer g_aging_timer;
+
+// -----------------------------------------------------------------------------
+void AgingTimer::every(Tick const period, std::function<void(Tick)> fn)
+{
+    sweeps_.push_back(Sweep{period, now() + period, std::move(fn)});
+}
+
+void AgingTimer::start()
+{
+    std::thread([this] { run(); }).detach();
+}
+
+void AgingTimer::run()
+{
+    // Sleep to absolute deadlines, so the clock does not drift by the
+    // time the sweeps take.
+    auto deadline = std::chrono::steady_clock::now();
+    for (;;) {
+        deadline += std::chrono::seconds(1);
+        std::this_thread::sleep_until(deadline);
+
+        Tick const now = now_.load(std::memory_order_relaxed) + 1;
+        now_.store(now, std::memory_order_relaxed);
+
+        for (Sweep& sweep : sweeps_) {
+            if (now >= sweep.next) {
+                sweep.next = now + sweep.period;
+                sweep.fn(now);
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// AgingTimer: coarse clock and periodic sweeps of the tables whose entries
+// expire, i.e. FDB aging and multicast group membership.
+//
+// The clock counts seconds since start() and is read with one relaxed
+// load, so the dataplane can stamp a table entry on every frame. The timer
+// thread advances it once a second, then runs the sweeps whose period has
+// passed. Sweeps run on the timer thread, so expiring entries costs the
+// dataplane threads nothing beyond the table lock.
+// -----------------------------------------------------------------------------
+class AgingTimer {
+public:
+    typedef uint32_t Tick;     // Seconds since start()
+
+    // Stamp of an entry that never ages out; no aging cutoff is past it
+    static constexpr Tick Never = ~Tick{0};
+
+    // Current time
+    Tick now() const { return now_.load(std::memory_order_relaxed); }
+
+    // Run fn(now) on the timer thread every period seconds; call before
+    // start()
+    void every(Tick period, std::function<void(Tick)> fn);
+
+    // Start the timer thread
+    void start();
+
+private:
+    // Timer thread
+    [[noreturn]] void run();
+
+    struct Sweep {
+        Tick                        period;
+        Tick                        next;    // Time of the next run
+        std::function<void(Tick)>   fn;
+    };
+
+private:
+    std::atomic<Tick>   now_{0};
+    std::vector<Sweep>  sweeps_;   // Set up before start(), then only
+                                   // touched by the timer thread
+};
+
+// Global timer shared by the dataplane and switch state
+extern AgingTimer g_aging_timer;
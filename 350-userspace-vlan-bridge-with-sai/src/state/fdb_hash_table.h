@@ -0,0 +1,32 @@
+#pragma once
+
+#include "open_hash_table.h"
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// FDB tables: open addressing hash tables (OpenHashTable) from a packed FDB
+// key ((VLAN << 48) | MAC) to a port.
+//
+// FdbHashTable backs the FDB and grows with it. BoundedFdbHashTable has a
+// fixed capacity, for tables of (VLAN, MAC) kept on the dataplane thread
+// that must never allocate there.
+// -----------------------------------------------------------------------------
+struct FdbKeyTraits {
+    typedef uint64_t Key;
+    typedef uint32_t Value;
+
+    // Never a valid packed key, as VLAN ids are 12 bits
+    static Key empty() { return ~Key{0}; }
+
+    static bool isEmpty(Key const key) { return key == ~Key{0}; }
+
+    static bool equal(Key const a, Key const b) { return a == b; }
+
+    static uint64_t hash(Key const key) { return hash_mix(key); }
+};
+
+typedef OpenHashTable<FdbKeyTraits, GrowingCapacity> FdbHashTable;
+typedef OpenHashTable<FdbKeyTraits, FixedCapacity>   BoundedFdbHashTable;
+
+static_assert(FdbHashTable::SlotBytes == 16, "the stamp fits in the slot padding");
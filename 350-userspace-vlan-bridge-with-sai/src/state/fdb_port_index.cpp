@@ -0,0 +1,41 @@
+#include "fdb_port_index.h"
+
+// -----------------------------------------------------------------------------
+void FdbPortIndex::reset(size_t const numPorts, size_t const keysPerPort)
+{
+    keys_.assign(numPorts, {});
+    count_.assign(numPorts, 0);
+    for (auto& keys : keys_) {
+        keys.reserve(keysPerPort);
+    }
+}
+
+void FdbPortIndex::add(FdbHashTable const& fdb, FdbHashTable::Key const key, Port const port)
+{
+    std::vector<FdbHashTable::Key>& keys = keys_[port];
+    keys.push_back(key);
+    count_[port]++;
+
+    // Drop the keys of entries that moved to other ports.
+    if (keys.size() > 2 * count_[port] + 16) {
+        std::erase_if(keys, [&fdb, port](FdbHashTable::Key const k) {
+            Port const* p = fdb.find(k);
+            return p == nullptr || *p != port;
+        });
+    }
+}
+
+size_t FdbPortIndex::flush(FdbHashTable& fdb, Port const port)
+{
+    size_t flushed = 0;
+    for (FdbHashTable::Key const key : keys_[port]) {
+        Port const* p = fdb.find(key);
+        if (p && *p == port) {
+            fdb.erase(key);
+            flushed++;
+        }
+    }
+    keys_[port].clear();
+    count_[port] = 0;
+    return flushed;
+}
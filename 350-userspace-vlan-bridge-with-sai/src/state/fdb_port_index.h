@@ -0,0 +1,38 @@
+#pragma once
+
+#include "fdb_hash_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// FdbPortIndex: keys of an FdbHashTable by the port they were learned at, so
+// that flushing a port costs O(entries on the port) instead of a scan of the
+// whole table.
+//
+// A key is added when its entry is learned at or moves to a port. When the
+// entry moves away or is removed, the key stays behind as a stale key, and
+// only the live count of the port drops; flush() skips stale keys. Stale
+// keys of a port are dropped once they outnumber its live ones.
+// -----------------------------------------------------------------------------
+class FdbPortIndex {
+public:
+    typedef FdbHashTable::Value Port;
+
+    // Empty index of numPorts ports, with room for keysPerPort keys each
+    void reset(size_t numPorts, size_t keysPerPort = 0);
+
+    // Record key as learned at port; fdb is the table it indexes
+    void add(FdbHashTable const& fdb, FdbHashTable::Key key, Port port);
+
+    // Note that an entry at port moved away or was removed from the table
+    void remove(Port const port) { count_[port]--; }
+
+    // Remove the entries of fdb still at port; return the number removed
+    size_t flush(FdbHashTable& fdb, Port port);
+
+private:
+    std::vector<std::vector<FdbHashTable::Key>> keys_;   // Port → keys
+    std::vector<size_t>                         count_;  // Port → entries
+};
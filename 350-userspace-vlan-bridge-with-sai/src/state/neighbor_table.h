@@ -0,0 +1,48 @@
+#pragma once
+
+#include "open_hash_table.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+// NeighborTable: open addressing hash table (OpenHashTable) from (VLAN, IP)
+// to the MAC bound to it, with a fixed capacity.
+//
+// The slot array is allocated once for the capacity, so the table never
+// grows on a dataplane thread; inserting into a full table fails.
+// -----------------------------------------------------------------------------
+struct NeighborKey {
+    typedef std::array<uint8_t, 16> Ip;
+
+    uint16_t vlan;
+    Ip       ip;
+};
+
+struct NeighborKeyTraits {
+    typedef NeighborKey Key;
+    typedef uint64_t    Value;
+
+    // Never a valid VLAN id, as VLAN ids are 12 bits
+    static constexpr uint16_t EmptyVlan = 0xffff;
+
+    static Key empty() { return {EmptyVlan, {}}; }
+
+    static bool isEmpty(Key const& key) { return key.vlan == EmptyVlan; }
+
+    static bool equal(Key const& a, Key const& b)
+    {
+        return a.vlan == b.vlan && a.ip == b.ip;
+    }
+
+    static uint64_t hash(Key const& key)
+    {
+        uint64_t hi, lo;
+        std::memcpy(&hi, key.ip.data(), sizeof(hi));
+        std::memcpy(&lo, key.ip.data() + sizeof(hi), sizeof(lo));
+        return hash_mix(lo ^ hash_mix(hi ^ key.vlan));
+    }
+};
+
+typedef OpenHashTable<NeighborKeyTraits, FixedCapacity> NeighborTable;
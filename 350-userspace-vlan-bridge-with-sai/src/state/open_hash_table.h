@@ -0,0 +1,326 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// -----------------------------------------------------------------------------
+// Hash mixing
+// -----------------------------------------------------------------------------
+
+// splitmix64 finalizer
+inline uint64_t hash_mix(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// -----------------------------------------------------------------------------
+// Capacity policies of OpenHashTable
+// -----------------------------------------------------------------------------
+
+// The slot array doubles whenever an insert would take the load factor
+// above 1/2
+struct GrowingCapacity {
+    static constexpr bool Grows = true;
+
+    enum {
+        InitialEntries = 512       // Entries before the first growth
+    };
+};
+
+// The slot array is sized once, on construction, so the table never
+// allocates afterwards; an insert into a full table fails
+struct FixedCapacity {
+    static constexpr bool Grows = false;
+};
+
+// -----------------------------------------------------------------------------
+// OpenHashTable: open addressing hash table from Traits::Key to
+// Traits::Value, with capacity policy Capacity.
+//
+// Slots live in one flat array and collisions are resolved by linear
+// probing, so a lookup touches one cache line in the common case. The
+// hash of a key is exposed, so that a batch of lookups can compute all
+// hashes and prefetch all buckets before resolving any of them. Erasing
+// shifts the rest of the probe run back, so no tombstones are left
+// behind.
+//
+// Each entry also carries a stamp, e.g. the time it was last refreshed,
+// for aging. The stamp is atomic, so refresh() may run under a shared
+// lock, alongside find(); everything else that modifies the table needs
+// exclusive access.
+//
+// Traits provides the Key and Value types, and
+//   static Key empty()                          key of an empty slot
+//   static bool isEmpty(Key const&)             whether a key is empty()
+//   static bool equal(Key const&, Key const&)
+//   static uint64_t hash(Key const&)
+// -----------------------------------------------------------------------------
+template <typename Traits, typename Capacity>
+class OpenHashTable {
+public:
+    typedef typename Traits::Key   Key;
+    typedef typename Traits::Value Value;
+    typedef uint32_t               Stamp;
+
+    // Room for GrowingCapacity::InitialEntries before growing
+    OpenHashTable() : OpenHashTable(Capacity::InitialEntries) {}
+
+    // Room for capacity entries before growing, or at all with
+    // FixedCapacity
+    explicit OpenHashTable(size_t const capacity) { allocate(capacity); }
+
+    // Hash of a key
+    static uint64_t hash(Key const& key) { return Traits::hash(key); }
+
+    // Prefetch the bucket of a hash
+    void prefetch(uint64_t const h) const
+    {
+        __builtin_prefetch(&slots_[h & mask_]);
+    }
+
+    // Find key whose hash is h; return nullptr if not found
+    Value const* find(Key const& key, uint64_t const h) const
+    {
+        for (uint64_t i = h & mask_; ; i = (i + 1) & mask_) {
+            Slot const& slot = slots_[i];
+            if (Traits::equal(slot.key, key))
+                return &slot.value;
+            if (Traits::isEmpty(slot.key))
+                return nullptr;
+        }
+    }
+
+    Value const* find(Key const& key) const
+    {
+        return find(key, hash(key));
+    }
+
+    // Set the stamp of key to stamp if key is bound to value; return false
+    // if it is not
+    bool refresh(Key const& key, Value const& value, Stamp const stamp)
+    {
+        uint64_t index;
+        if (!findSlot(key, index) || slots_[index].value != value) {
+            return false;
+        }
+        slots_[index].stamp.store(stamp, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Insert key if not present; return (value, inserted). The stamp of
+    // the entry is set to stamp either way. Only an insert may grow the
+    // slot array, so a present key's value pointer is never invalidated.
+    // With FixedCapacity, inserting into a full table returns (nullptr,
+    // false).
+    std::pair<Value*, bool> emplace(Key const& key, Value const& value, Stamp const stamp = 0)
+    {
+        uint64_t const h = hash(key);
+        uint64_t i = h & mask_;
+        for (; !Traits::isEmpty(slots_[i].key); i = (i + 1) & mask_) {
+            if (Traits::equal(slots_[i].key, key)) {
+                slots_[i].stamp.store(stamp, std::memory_order_relaxed);
+                return {&slots_[i].value, false};
+            }
+        }
+
+        if (size_ >= capacity_) {
+            if constexpr (!Capacity::Grows) {
+                return {nullptr, false};
+            } else {
+                grow();
+                for (i = h & mask_; !Traits::isEmpty(slots_[i].key); i = (i + 1) & mask_) {
+                }
+            }
+        }
+
+        Slot& slot = slots_[i];
+        slot.key = key;
+        slot.value = value;
+        slot.stamp.store(stamp, std::memory_order_relaxed);
+        size_++;
+        return {&slot.value, true};
+    }
+
+    // Remove key; return false if not found
+    bool erase(Key const& key)
+    {
+        uint64_t index;
+        if (!findSlot(key, index)) {
+            return false;
+        }
+        eraseAt(index);
+        return true;
+    }
+
+    // Remove key if its stamp is before cutoff; return false if not found
+    // or stamped later. If removed and outValue is given, it receives the
+    // value of key.
+    bool eraseIfBefore(Key const& key, Stamp const cutoff, Value* const outValue = nullptr)
+    {
+        uint64_t index;
+        if (!findSlot(key, index) ||
+            slots_[index].stamp.load(std::memory_order_relaxed) >= cutoff) {
+            return false;
+        }
+        if (outValue) {
+            *outValue = slots_[index].value;
+        }
+        eraseAt(index);
+        return true;
+    }
+
+    // Number of entries
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    // Entries the table holds before growing, or at all with FixedCapacity
+    size_t capacity() const { return capacity_; }
+
+    // Remove all entries. With GrowingCapacity the slot array shrinks back
+    // to its initial size.
+    void clear()
+    {
+        if constexpr (Capacity::Grows) {
+            allocate(Capacity::InitialEntries);
+        } else {
+            for (size_t i = 0; i <= mask_; i++) {
+                slots_[i].key = Traits::empty();
+            }
+            size_ = 0;
+        }
+    }
+
+    // Size the slot array for entries, so that inserting up to that many
+    // entries never grows it
+    void reserve(size_t const entries)
+    {
+        static_assert(Capacity::Grows, "a FixedCapacity table is sized on construction");
+        while (entries > capacity_) {
+            grow();
+        }
+    }
+
+    // Invoke fn(key, value) for every entry, in no particular order
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        for (size_t i = 0; i <= mask_; i++) {
+            Slot const& slot = slots_[i];
+            if (!Traits::isEmpty(slot.key)) {
+                fn(slot.key, slot.value);
+            }
+        }
+    }
+
+    // Invoke fn(key, value) for every entry stamped before cutoff, in no
+    // particular order
+    template <typename Fn>
+    void forEachBefore(Stamp const cutoff, Fn&& fn) const
+    {
+        for (size_t i = 0; i <= mask_; i++) {
+            Slot const& slot = slots_[i];
+            if (!Traits::isEmpty(slot.key) && slot.stamp.load(std::memory_order_relaxed) < cutoff) {
+                fn(slot.key, slot.value);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        Key                 key = Traits::empty();
+        Value               value{};
+        std::atomic<Stamp>  stamp{0};
+    };
+
+public:
+    // Bytes per slot, so that users can check the layout of theirs
+    static constexpr size_t SlotBytes = sizeof(Slot);
+
+private:
+    static void copySlot(Slot& to, Slot const& from)
+    {
+        to.key = from.key;
+        to.value = from.value;
+        to.stamp.store(from.stamp.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // Replace the slot array by an empty one with room for capacity entries;
+    // keep the load factor at or below 1/2, so probe sequences stay short
+    void allocate(size_t const capacity)
+    {
+        size_t const slots = std::bit_ceil(2 * capacity);
+        slots_ = std::make_unique<Slot[]>(slots);
+        mask_ = slots - 1;
+        capacity_ = Capacity::Grows ? slots / 2 : capacity;
+        size_ = 0;
+    }
+
+    // Slot index of key; false if not found
+    bool findSlot(Key const& key, uint64_t& outIndex) const
+    {
+        for (uint64_t i = hash(key) & mask_; ; i = (i + 1) & mask_) {
+            if (Traits::equal(slots_[i].key, key)) {
+                outIndex = i;
+                return true;
+            }
+            if (Traits::isEmpty(slots_[i].key))
+                return false;
+        }
+    }
+
+    // Empty the slot at index
+    void eraseAt(uint64_t hole)
+    {
+        // Backward-shift deletion: move each later entry of the run into the
+        // hole, unless the hole lies before the entry's home bucket.
+        for (uint64_t i = (hole + 1) & mask_; !Traits::isEmpty(slots_[i].key);
+             i = (i + 1) & mask_) {
+            uint64_t const home = hash(slots_[i].key) & mask_;
+            if (((i - home) & mask_) >= ((i - hole) & mask_)) {
+                copySlot(slots_[hole], slots_[i]);
+                hole = i;
+            }
+        }
+
+        slots_[hole].key = Traits::empty();
+        size_--;
+    }
+
+    // Double the slot array and reinsert all entries
+    void grow()
+    {
+        std::unique_ptr<Slot[]> old = std::move(slots_);
+        size_t const oldSlots = mask_ + 1;
+        size_t const entries = size_;
+        allocate(oldSlots);
+        size_ = entries;
+
+        for (size_t j = 0; j < oldSlots; j++) {
+            Slot const& slot = old[j];
+            if (Traits::isEmpty(slot.key))
+                continue;
+            for (uint64_t i = hash(slot.key) & mask_; ; i = (i + 1) & mask_) {
+                if (Traits::isEmpty(slots_[i].key)) {
+                    copySlot(slots_[i], slot);
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    std::unique_ptr<Slot[]> slots_;
+    uint64_t                mask_;       // Slot count - 1
+    size_t                  capacity_;   // Entries before growing, or at all
+    size_t                  size_;       // Used slots
+};
@@ -0,0 +1,187 @@
+#include "port_config.h"
+
+#include <net/if.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+// Check an interface name and that no earlier port uses it
+static bool
+check_ifname(
+    std::string const& ifname,
+    std::set<std::string>& seen,
+    std::string& err)
+{
+    if (ifname.empty() || ifname.size() >= IF_NAMESIZE) {
+        err = "invalid interface name '" + ifname + "'";
+        return false;
+    }
+    if (!seen.insert(ifname).second) {
+        err = "interface " + ifname + " listed twice";
+        return false;
+    }
+    return true;
+}
+
+// Parse a storm control limit, "<n>pps" or "<n>[k|m|g]bps"
+static bool
+parse_storm_limit(std::string const& value, StormLimit& limit, std::string& err)
+{
+    static constexpr struct {
+        char const* suffix;
+        uint64_t    scale;
+        bool        bits;
+    } units[] = {
+        {"pps", 1, false},
+        {"bps", 1, true},
+        {"kbps", 1000, true},
+        {"mbps", 1000 * 1000, true},
+        {"gbps", 1000 * 1000 * 1000, true},
+    };
+
+    unsigned long long rate = 0;
+    int used = 0;
+    if (std::isdigit(static_cast<unsigned char>(value[0])) &&
+        std::sscanf(value.c_str(), "%llu%n", &rate, &used) == 1 && rate != 0) {
+        char const* const suffix = value.c_str() + used;
+        for (auto const& unit : units) {
+            if (std::strcmp(suffix, unit.suffix) == 0 && rate <= UINT64_MAX / unit.scale) {
+                limit.rate = rate * unit.scale;
+                limit.bits = unit.bits;
+                return true;
+            }
+        }
+    }
+    err = "invalid storm control limit '" + value + "', expected <n>pps or <n>[k|m|g]bps";
+    return false;
+}
+
+std::string tostring(StormLimit const& limit)
+{
+    if (limit.rate == 0) {
+        return "unlimited";
+    }
+    return std::to_string(limit.rate) + (limit.bits ? "bps" : "pps");
+}
+
+// Apply one "<key>=<value>" setting to port
+static bool
+parse_setting(std::string const& item, PortSettings& port, std::string& err)
+{
+    size_t const eq = item.find('=');
+    std::string const key = item.substr(0, eq);
+    std::string const value = (eq == std::string::npos) ? std::string{} : item.substr(eq + 1);
+
+    if (key == "weight") {
+        unsigned weight = 0;
+        char extra = 0;
+        if (std::sscanf(value.c_str(), "%u%c", &weight, &extra) != 1 || weight == 0) {
+            err = "invalid weight '" + value + "'";
+            return false;
+        }
+        port.weight = weight;
+        return true;
+    }
+
+    if (key == "tpid") {
+        unsigned tpid = 0;
+        char extra = 0;
+        if (std::sscanf(value.c_str(), "0x%x%c", &tpid, &extra) != 1 ||
+            (tpid != 0x8100 && tpid != 0x88a8)) {
+            err = "invalid tpid '" + value + "', expected 0x8100 or 0x88a8";
+            return false;
+        }
+        port.tpid = static_cast<uint16_t>(tpid);
+        return true;
+    }
+
+    if (key == "lag") {
+        unsigned lag = 0;
+        char extra = 0;
+        if (std::sscanf(value.c_str(), "%u%c", &lag, &extra) != 1 || lag == 0) {
+            err = "invalid lag '" + value + "'";
+            return false;
+        }
+        port.lag = lag;
+        return true;
+    }
+
+    if (key == "storm-bcast") {
+        return parse_storm_limit(value, port.stormBroadcast, err);
+    }
+    if (key == "storm-mcast") {
+        return parse_storm_limit(value, port.stormMulticast, err);
+    }
+    if (key == "storm-unknown") {
+        return parse_storm_limit(value, port.stormUnknown, err);
+    }
+
+    err = "unknown setting '" + item + "'";
+    return false;
+}
+
+bool load_port_config(std::string const& path, PortConfig& outPorts, std::string& err)
+{
+    std::ifstream in(path);
+    if (!in) {
+        err = "cannot open " + path;
+        return false;
+    }
+
+    outPorts.clear();
+    std::set<std::string> seen;
+    std::string line;
+    for (unsigned lineNo = 1; std::getline(in, line); lineNo++) {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word)) {
+            continue;
+        }
+
+        PortSettings port;
+        port.ifname = word;
+        bool ok = check_ifname(port.ifname, seen, err);
+        while (ok && words >> word) {
+            ok = parse_setting(word, port, err);
+        }
+        if (!ok) {
+            err = path + ":" + std::to_string(lineNo) + ": " + err;
+            return false;
+        }
+        outPorts.push_back(port);
+    }
+
+    if (outPorts.empty()) {
+        err = path + ": no ports";
+        return false;
+    }
+    return true;
+}
+
+bool parse_port_list(std::string const& list, PortConfig& outPorts, std::string& err)
+{
+    outPorts.clear();
+    std::set<std::string> seen;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        PortSettings port;
+        port.ifname = list.substr(start, end - start);
+        if (!check_ifname(port.ifname, seen, err)) {
+            return false;
+        }
+        outPorts.push_back(port);
+        start = end + 1;
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Port configuration, loaded at startup
+//
+// A port config file lists one port per line, in port id order:
+//
+//     # <interface> [<key>=<value>]...
+//     veth0 weight=2
+//     veth1 tpid=0x88a8
+//     veth2 storm-bcast=100pps storm-unknown=10mbps
+//     veth3 lag=1
+//
+// Keys:
+//     weight         Ingress scheduler weight (default 1)
+//     tpid           TPID of the port's VLAN tags: 0x8100 for 802.1Q
+//                    (default), or 0x88a8 for an 802.1ad provider port,
+//                    which classifies on the S-tag and carries customer
+//                    tags as payload
+//     storm-bcast    Storm control limit of the broadcast, multicast, and
+//     storm-mcast    unknown unicast frames the port floods: <n>pps, or
+//     storm-unknown  <n>bps, <n>kbps, <n>mbps, <n>gbps (default unlimited)
+//     lag            LAG the port is a member of, <n> >= 1; ports with the
+//                    same n form one LAG (default none)
+//
+// Empty lines and text after '#' are ignored.
+// -----------------------------------------------------------------------------
+
+// Storm control limit of one traffic class
+struct StormLimit {
+    uint64_t rate = 0;           // Frames or bits per second; 0 is unlimited
+    bool     bits = false;       // rate is in bits, not frames, per second
+};
+
+struct PortSettings {
+    std::string ifname;          // Interface the port is bound to
+    uint32_t    weight = 1;      // Ingress scheduler weight
+    uint16_t    tpid = 0x8100;   // TPID of the port's VLAN tags
+    StormLimit  stormBroadcast;  // Broadcast floods
+    StormLimit  stormMulticast;  // Multicast floods
+    StormLimit  stormUnknown;    // Unknown unicast floods
+    uint32_t    lag = 0;         // LAG number; 0 if not in a LAG
+};
+
+// String representation of a storm control limit, e.g. "100pps"
+std::string tostring(StormLimit const& limit);
+
+// Port id → settings
+typedef std::vector<PortSettings> PortConfig;
+
+// Default config file, written by tools/setup.sh
+constexpr char const* DefaultPortConfigFile = "switch_ports.conf";
+
+// Load ports from a config file; on failure, set err and return false
+bool load_port_config(std::string const& path, PortConfig& outPorts, std::string& err);
+
+// Parse ports from "<interface>,<interface>,..." with default settings;
+// on failure, set err and return false
+bool parse_port_list(std::string const& list, PortConfig& outPorts, std::string& err);
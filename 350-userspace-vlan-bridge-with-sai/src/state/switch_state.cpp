@@ -1,11 +1,13 @@
 #include "switch_state.h"
-#include "switch_config.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <limits>
 #include <mutex>
 #include <string>
 
 void sai_inform_mac_learn( uint16_t vlan, uint64_t mac, uint16_t port);
+void sai_inform_mac_aged(uint16_t vlan, uint64_t mac, uint16_t port);
 
 MacString macToString(MacAddress const mac) {
     MacString result;
@@ -46,19 +48,250 @@ MacAddress extract_mac(uint8_t const * const p)
     return m;
 }
 // -----------------------------------------------------------------------------
-SwitchState::SwitchState() : numPorts_{NumSwitchPorts}
+SwitchState::SwitchState() : numPorts_{0}
 {
     reset();
 }
 
+void SwitchState::configurePorts(PortConfig const& ports)
+{
+    {
+        std::unique_lock lock(mtx_);
+        numPorts_ = static_cast<int>(ports.size());
+        ports_ = ports;
+        portOperUp_.assign(ports.size(), 1);
+        portIfindex_.assign(ports.size(), 0);
+        configureLags();
+    }
+    reset();
+
+    std::unique_lock lock(mtx_);
+    fdb_.reserve(FdbEntriesPerPort * ports.size());
+    fdbPortIndex_.reset(ports.size(), FdbEntriesPerPort);
+}
+
+
+// -----------------------------------------------------------------------------
+int SwitchState::numPorts() const
+{
+    return numPorts_;
+}
+
+PortSettings const& SwitchState::portSettings(PortId const port) const
+{
+    assert(static_cast<int>(port) < numPorts_);
+    return ports_[port];
+}
+
 
 // -----------------------------------------------------------------------------
 void SwitchState::reset()
 {
     std::unique_lock lock(mtx_);
     vlanMembers_.clear();
+    taggedMembers_.clear();
+    learnDisabledVlans_.clear();
+    portLearnMode_.assign(static_cast<size_t>(numPorts_), LearnMode::Hardware);
+    clearReportedMacs();
     fdb_.clear();
     portPvid_.clear();
+    fdbPortIndex_.reset(static_cast<size_t>(numPorts_));
+    portFlushes_.assign(static_cast<size_t>(numPorts_), 0);
+    mcastGroups_.clear();
+    mcastRouterExpiry_.clear();
+    mcastRouterPorts_.fill(0);
+    mcastNextExpiry_.store(std::numeric_limits<AgingTimer::Tick>::max(), std::memory_order_relaxed);
+    neighbors_.clear();
+
+    floodSets_.fill(nullptr);
+
+    // VLAN 0 has no tagged members, so every port floods untagged.
+    allPortsFloodSets_ = buildFloodSets(0, allPorts());
+}
+
+VlanMemberList SwitchState::allPorts() const
+{
+    VlanMemberList ports;
+    for (PortId port = 0; port < static_cast<PortId>(numPorts_); port++) {
+        ports.push_back(port);
+    }
+    return ports;
+}
+
+
+bool SwitchState::setPortOperUp(PortId const port, bool const up, size_t* const outLagMoved)
+{
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::unique_lock lock(mtx_);
+    if ((portOperUp_[port] != 0) == up) {
+        return false;
+    }
+    portOperUp_[port] = up;
+
+    Lag* const lag = lagOf_[portLag_[port]].get();
+    size_t const moved = lag ? rebalanceLag(*lag, portOperUp_) : 0;
+    if (outLagMoved) {
+        *outLagMoved = moved;
+    }
+
+    // Rebuild every VLAN's flood sets with or without the port.
+    rebuildAllFloodSets();
+    return true;
+}
+
+bool SwitchState::isPortOperUp(PortId const port) const
+{
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::shared_lock lock(mtx_);
+    return portOperUp_[port] != 0;
+}
+
+void SwitchState::setPortIfindex(PortId const port, int const ifindex)
+{
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::unique_lock lock(mtx_);
+    portIfindex_[port] = ifindex;
+}
+
+int SwitchState::portIfindex(PortId const port) const
+{
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::shared_lock lock(mtx_);
+    return portIfindex_[port];
+}
+
+
+// -----------------------------------------------------------------------------
+// LAG APIs
+// -----------------------------------------------------------------------------
+void SwitchState::configureLags()
+{
+    size_t const numPorts = ports_.size();
+    portLag_.resize(numPorts);
+    lagOf_.clear();
+    lagOf_.resize(numPorts);
+
+    // Ports are visited in id order, so the first member of a LAG is its
+    // LAG port.
+    std::map<uint32_t, PortId> lagPorts;
+    for (PortId port = 0; port < numPorts; port++) {
+        uint32_t const lag = ports_[port].lag;
+        portLag_[port] = port;
+        if (lag == 0) {
+            continue;
+        }
+        auto const [it, inserted] = lagPorts.emplace(lag, port);
+        portLag_[port] = it->second;
+        if (inserted) {
+            lagOf_[port] = std::make_unique<Lag>();
+        }
+        lagOf_[it->second]->members.push_back(port);
+    }
+
+    // Deal the buckets out round robin.
+    for (auto const& lag : lagOf_) {
+        if (!lag) {
+            continue;
+        }
+        for (size_t b = 0; b < LagBuckets; b++) {
+            lag->buckets[b].store(lag->members[b % lag->members.size()],
+                                  std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t SwitchState::rebalanceLag(Lag& lag, std::vector<uint8_t> const& portOperUp)
+{
+    // Buckets per member that is up
+    std::map<PortId, size_t> counts;
+    for (PortId const member : lag.members) {
+        if (portOperUp[member]) {
+            counts[member] = 0;
+        }
+    }
+    if (counts.empty()) {
+        return 0;
+    }
+    for (auto const& bucket : lag.buckets) {
+        auto const it = counts.find(bucket.load(std::memory_order_relaxed));
+        if (it != counts.end()) {
+            it->second++;
+        }
+    }
+
+    auto const fewest = [&counts] {
+        return std::min_element(counts.begin(), counts.end(),
+            [](auto const& a, auto const& b) { return a.second < b.second; });
+    };
+    auto const most = [&counts] {
+        return std::max_element(counts.begin(), counts.end(),
+            [](auto const& a, auto const& b) { return a.second < b.second; });
+    };
+
+    // Buckets of down members go to the up members with the fewest; the
+    // other buckets keep their member.
+    size_t moved = 0;
+    for (auto& bucket : lag.buckets) {
+        if (counts.count(bucket.load(std::memory_order_relaxed)) == 0) {
+            auto const to = fewest();
+            bucket.store(to->first, std::memory_order_relaxed);
+            to->second++;
+            moved++;
+        }
+    }
+
+    // Even out the counts, e.g. for a member that came back up, one
+    // bucket at a time from the member with the most.
+    for (;;) {
+        auto const from = most();
+        auto const to = fewest();
+        if (from->second <= to->second + 1) {
+            break;
+        }
+        for (auto& bucket : lag.buckets) {
+            if (bucket.load(std::memory_order_relaxed) == from->first) {
+                bucket.store(to->first, std::memory_order_relaxed);
+                break;
+            }
+        }
+        from->second--;
+        to->second++;
+        moved++;
+    }
+    return moved;
+}
+
+std::map<PortId, VlanMemberList> SwitchState::lagMembers() const
+{
+    std::map<PortId, VlanMemberList> lags;
+    for (PortId port = 0; port < lagOf_.size(); port++) {
+        if (lagOf_[port]) {
+            lags[port] = lagOf_[port]->members;
+        }
+    }
+    return lags;
+}
+
+bool SwitchState::lagUpLocked(PortId const port) const
+{
+    Lag const* const lag = lagOf_[portLag_[port]].get();
+    if (!lag) {
+        return portOperUp_[port] != 0;
+    }
+    return std::any_of(lag->members.begin(), lag->members.end(),
+                       [this](PortId const member) { return portOperUp_[member] != 0; });
+}
+
+bool SwitchState::isLagUp(PortId const port) const
+{
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::shared_lock lock(mtx_);
+    return lagUpLocked(port);
 }
 
 
@@ -72,10 +305,11 @@ void SwitchState::createVlan(VlanId vlan)
     // If the vlan does not exist, then create it with zero members.
     if (vlanMembers_.count(vlan) == 0) {
         vlanMembers_[vlan] = VlanMemberList{};
+        rebuildFloodSets(vlan);
     }
 }
 
-void SwitchState::addVlanMember(VlanId vlan, PortId port, bool /*tagged*/)
+void SwitchState::addVlanMember(VlanId vlan, PortId port, bool tagged)
 {
     assert(vlan <= MaxVlanId);
     assert(static_cast<int>(port) < numPorts_);
@@ -85,10 +319,45 @@ void SwitchState::addVlanMember(VlanId vlan, PortId port, bool /*tagged*/)
     auto it = vlanMembers_.find(vlan);
     if (it != vlanMembers_.end()) {
         it->second.push_back(port);
-        portPvid_[port] = vlan;
+        if (tagged) {
+            taggedMembers_.emplace(vlan, port);
+        } else {
+            portPvid_[port] = vlan;
+        }
+        rebuildFloodSets(vlan);
     }
 }
 
+bool SwitchState::setVlanLearning(VlanId const vlan, bool const enabled)
+{
+    assert(vlan <= MaxVlanId);
+
+    std::unique_lock lock(mtx_);
+
+    if (vlanMembers_.count(vlan) == 0) {
+        return false;
+    }
+    if (enabled) {
+        learnDisabledVlans_.erase(vlan);
+    } else {
+        learnDisabledVlans_.insert(vlan);
+    }
+    clearReportedMacs();
+    rebuildFloodSets(vlan);
+    return true;
+}
+
+void SwitchState::setPortLearnMode(PortId const port, LearnMode const mode)
+{
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::unique_lock lock(mtx_);
+
+    portLearnMode_[port] = mode;
+    clearReportedMacs();
+    rebuildAllFloodSets();
+}
+
 bool SwitchState::getVlanMembers(VlanId vlan, VlanMemberList& outMembers) const
 {
     assert(vlan <= MaxVlanId);
@@ -105,26 +374,147 @@ bool SwitchState::getVlanMembers(VlanId vlan, VlanMemberList& outMembers) const
     return true;
 }
 
+VlanFloodSetsPtr SwitchState::getFloodSets(VlanId vlan) const
+{
+    assert(vlan <= MaxVlanId);
 
-// -----------------------------------------------------------------------------
-// FDB APIs
-// -----------------------------------------------------------------------------
-// Return (learned, moved)
-std::pair<bool, bool> SwitchState::learnMac(VlanId vlan, MacAddress mac, PortId port)
+    std::shared_lock lock(mtx_);
+
+    VlanFloodSetsPtr const& floodSets = floodSets_[vlan];
+    return floodSets ? floodSets : allPortsFloodSets_;
+}
+
+VlanFloodSetsPtr SwitchState::buildFloodSets(VlanId vlan, VlanMemberList const& members) const
+{
+    auto floodSets = std::make_shared<VlanFloodSets>();
+    floodSets->byIngress.resize(static_cast<size_t>(numPorts_));
+    floodSets->tagging.assign(static_cast<size_t>(numPorts_), VlanTagging::None);
+    for (PortId p : members) {
+        floodSets->tagging[p] = taggedMembers_.count({vlan, p}) ? VlanTagging::Tagged
+                                                                : VlanTagging::Untagged;
+    }
+
+    // Learning disabled on the VLAN overrides the port modes.
+    if (learnDisabledVlans_.count(vlan)) {
+        floodSets->learning.assign(static_cast<size_t>(numPorts_), LearnMode::Disable);
+    } else {
+        floodSets->learning = portLearnMode_;
+    }
+
+    // A frame is flooded to every member except the ingress port and
+    // ports that are down. The ingress port need not be a member, e.g.
+    // when it is classified into the VLAN by default. LAG members are
+    // replaced by their LAG port, which is flooded once if any member is
+    // up, and never back to the LAG of the ingress port.
+    for (PortId ingress = 0; ingress < static_cast<PortId>(numPorts_); ingress++) {
+        FloodSet& floodSet = floodSets->byIngress[ingress];
+        for (PortId const member : members) {
+            PortId const p = portLag_[member];
+            if (p == portLag_[ingress] || !lagUpLocked(p)) {
+                continue;
+            }
+            EgressPorts& egress = (floodSets->tagging[p] == VlanTagging::Tagged)
+                                      ? floodSet.tagged : floodSet.untagged;
+            if (p != member && std::find(egress.ports.begin(), egress.ports.end(), p)
+                                   != egress.ports.end()) {
+                continue;
+            }
+            egress.ports.push_back(p);
+            if (p < PortBitmapMaxPorts) {
+                egress.bitmap |= PortBitmap{1} << p;
+            }
+        }
+    }
+
+    return floodSets;
+}
+
+void SwitchState::rebuildFloodSets(VlanId vlan)
+{
+    auto it = vlanMembers_.find(vlan);
+    floodSets_[vlan] = (it == vlanMembers_.end()) ? nullptr : buildFloodSets(vlan, it->second);
+}
+
+void SwitchState::rebuildAllFloodSets()
+{
+    for (auto const& [vlan, members] : vlanMembers_) {
+        rebuildFloodSets(vlan);
+    }
+    allPortsFloodSets_ = buildFloodSets(0, allPorts());
+}
+
+bool SwitchState::classifyVlan(
+    PortId const port,
+    bool const tagged,
+    VlanId const vid,
+    VlanId& outVlan,
+    LearnMode& outLearn) const
+{
+    assert(static_cast<int>(port) < numPorts_);
+    assert(vid <= MaxVlanId);
+
+    std::shared_lock lock(mtx_);
+
+    auto const it = portPvid_.find(port);
+    VlanId const pvid = (it == portPvid_.end()) ? VlanId{DefaultVlanId} : it->second;
+
+    // Untagged and priority-tagged frames belong to the PVID.
+    if (!tagged || vid == 0) {
+        VlanFloodSetsPtr const& floodSets = floodSets_[pvid];
+        outVlan = pvid;
+        outLearn = (floodSets ? floodSets : allPortsFloodSets_)->learning[port];
+        return true;
+    }
+
+    // Ingress filtering: a tagged frame is accepted for a VLAN the port is
+    // a member of, or for the port's own VLAN when that is not configured.
+    VlanFloodSetsPtr const& floodSets = floodSets_[vid];
+    bool const accept = floodSets ? floodSets->tagging[port] != VlanTagging::None
+                                  : vid == pvid;
+    outVlan = vid;
+    outLearn = (floodSets ? floodSets : allPortsFloodSets_)->learning[port];
+    return accept;
+}
+
+bool SwitchState::taggedEgressLocked(VlanId const vlan, PortId const port) const
+{
+    VlanFloodSetsPtr const& floodSets = floodSets_[vlan];
+    return floodSets && floodSets->tagging[port] == VlanTagging::Tagged;
+}
+
+bool SwitchState::isTaggedEgress(VlanId const vlan, PortId const port) const
 {
     assert(vlan <= MaxVlanId);
     assert(static_cast<int>(port) < numPorts_);
 
-    std::unique_lock lock(mtx_);
+    std::shared_lock lock(mtx_);
+    return taggedEgressLocked(vlan, port);
+}
 
+
+// -----------------------------------------------------------------------------
+// FDB APIs
+// -----------------------------------------------------------------------------
+// Return (learned, moved)
+std::pair<bool, bool> learn_fdb_entry(FdbHashTable& fdb, VlanId vlan, MacAddress mac, PortId port,
+                                      AgingTimer::Tick const now, FdbPortIndex* const index)
+{
     FdbKey const key(vlan, mac);
-    auto [it, inserted] = fdb_.emplace(key, port);
+    auto [value, inserted] = fdb.emplace(key.packed(), port, now);
     if (inserted) {
+        if (index) {
+            index->add(fdb, key.packed(), port);
+        }
         return {true, false};
     }
 
-    if (it->second != port) {
-        it->second = port;
+    if (*value != port) {
+        PortId const movedFrom = *value;
+        *value = port;
+        if (index) {
+            index->remove(movedFrom);
+            index->add(fdb, key.packed(), port);
+        }
         return {false, true};
     }
 
@@ -137,41 +527,252 @@ std::pair<bool, bool> SwitchState::learnMac(VlanId vlan, MacAddress mac, PortId
     return {false, false};
 }
 
-bool SwitchState::lookupFdb(VlanId vlan, MacAddress mac, PortId& outPort) const
+size_t age_fdb_entries(FdbHashTable& fdb, FdbHashTable::Stamp const cutoff,
+                       FdbPortIndex* const index)
+{
+    std::vector<uint64_t> aged;
+    fdb.forEachBefore(cutoff, [&aged](uint64_t const key, PortId) {
+        aged.push_back(key);
+    });
+
+    for (uint64_t const key : aged) {
+        PortId port = 0;
+        fdb.eraseIfBefore(key, cutoff, &port);
+        if (index) {
+            index->remove(port);
+        }
+        FdbKey const k(key);
+        sai_inform_mac_aged(k.vlan(), k.mac(), static_cast<uint16_t>(port));
+    }
+    return aged.size();
+}
+
+// Return (learned, moved)
+std::pair<bool, bool> SwitchState::learnMac(VlanId vlan, MacAddress mac, PortId port,
+                                            AgingTimer::Tick const seen)
+{
+    assert(vlan <= MaxVlanId);
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::unique_lock lock(mtx_);
+
+    // Sources received on a LAG member are learned at the LAG.
+    port = portLag_[port];
+    return learn_fdb_entry(fdb_, vlan, mac, port, seen, &fdbPortIndex_);
+}
+
+bool SwitchState::reportMac(VlanId vlan, MacAddress mac, PortId port, LearnMode mode)
+{
+    assert(vlan <= MaxVlanId);
+    assert(static_cast<int>(port) < numPorts_);
+
+    port = portLag_[port];
+    FdbKey const key(vlan, mac);
+    {
+        std::shared_lock lock(mtx_);
+        PortId const* seen = reportedMacs_.find(key.packed());
+        if (seen && *seen == port) {
+            return false;
+        }
+    }
+    {
+        std::unique_lock lock(mtx_);
+        auto [seen, inserted] = reportedMacs_.emplace(key.packed(), port, g_aging_timer.now());
+        if (!seen) {
+            reportOverflows_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!inserted) {
+            if (*seen == port) {
+                return false;
+            }
+            *seen = port;
+        }
+    }
+
+    if (mode == LearnMode::Notify) {
+        sai_inform_mac_learn(
+            static_cast<uint16_t>(vlan),
+            static_cast<uint64_t>(mac),
+            static_cast<uint16_t>(port)
+        );
+    }
+    return true;
+}
+
+size_t SwitchState::ageReportedMacs(AgingTimer::Tick const now)
+{
+    FdbHashTable::Stamp const cutoff = fdb_aging_cutoff(now, fdbAgingTime());
+    if (cutoff == 0) {
+        return 0;
+    }
+
+    std::unique_lock lock(mtx_);
+    std::vector<uint64_t> aged;
+    reportedMacs_.forEachBefore(cutoff, [&aged](uint64_t const key, PortId) {
+        aged.push_back(key);
+    });
+    for (uint64_t const key : aged) {
+        reportedMacs_.erase(key);
+    }
+    return aged.size();
+}
+
+void SwitchState::clearReportedMacs()
+{
+    reportedMacs_.clear();
+}
+
+size_t SwitchState::flushFdbPort(PortId const port)
+{
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::unique_lock lock(mtx_);
+    size_t const flushed = fdbPortIndex_.flush(fdb_, port);
+    portFlushes_[port]++;
+    fdbFlushes_.fetch_add(1, std::memory_order_release);
+    return flushed;
+}
+
+std::vector<uint64_t> SwitchState::portFlushes() const
+{
+    std::shared_lock lock(mtx_);
+    return portFlushes_;
+}
+
+bool SwitchState::lookupFdb(VlanId vlan, MacAddress mac, PortId& outPort, bool* outTagged) const
 {
     assert(vlan <= MaxVlanId);
 
     std::shared_lock lock(mtx_);
 
     FdbKey key(vlan, mac);
-    auto it = fdb_.find(key);
-    if (it == fdb_.end())
+    PortId const* port = fdb_.find(key.packed());
+    if (port == nullptr)
         return false;
 
-    outPort = it->second;
+    outPort = *port;
+    if (outTagged) {
+        *outTagged = taggedEgressLocked(vlan, outPort);
+    }
     return true;
 }
 
+size_t SwitchState::lookupFdbBatch(
+    FdbLookupKey const* keys,
+    size_t const count,
+    PortId* outPorts,
+    bool* outFound,
+    bool* outTagged) const
+{
+    std::shared_lock lock(mtx_);
+
+    size_t numFound = 0;
+    uint64_t packed[FdbLookupBatchSize];
+    uint64_t hashes[FdbLookupBatchSize];
+
+    for (size_t base = 0; base < count; base += FdbLookupBatchSize) {
+        size_t const n = std::min<size_t>(count - base, FdbLookupBatchSize);
+
+        // Stage 1: hash all keys and prefetch their buckets.
+        for (size_t i = 0; i < n; i++) {
+            FdbLookupKey const& k = keys[base + i];
+            assert(k.vlan <= MaxVlanId);
+            packed[i] = FdbKey(k.vlan, k.mac).packed();
+            hashes[i] = FdbHashTable::hash(packed[i]);
+            fdb_.prefetch(hashes[i]);
+        }
+
+        // Stage 2: resolve; the buckets are in cache or on their way.
+        for (size_t i = 0; i < n; i++) {
+            PortId const* port = fdb_.find(packed[i], hashes[i]);
+            outFound[base + i] = (port != nullptr);
+            if (port) {
+                outPorts[base + i] = *port;
+                if (outTagged) {
+                    outTagged[base + i] = taggedEgressLocked(keys[base + i].vlan, *port);
+                }
+                numFound++;
+            }
+        }
+    }
+
+    return numFound;
+}
+
+void SwitchState::reserveFdb(size_t const entries)
+{
+    std::unique_lock lock(mtx_);
+    fdb_.reserve(entries);
+}
+
+void SwitchState::setFdbAgingTime(uint32_t const secs)
+{
+    fdbAgingSecs_.store(secs, std::memory_order_relaxed);
+}
+
+size_t SwitchState::ageFdb(AgingTimer::Tick const now)
+{
+    FdbHashTable::Stamp const cutoff = fdb_aging_cutoff(now, fdbAgingTime());
+    if (cutoff == 0) {
+        return 0;
+    }
+
+    std::vector<uint64_t> candidates;
+    {
+        std::shared_lock lock(mtx_);
+        fdb_.forEachBefore(cutoff, [&candidates](uint64_t const key, PortId) {
+            candidates.push_back(key);
+        });
+    }
+    if (candidates.empty()) {
+        return 0;
+    }
+
+    // An entry refreshed since the scan stays.
+    std::vector<std::pair<FdbKey, PortId>> aged;
+    {
+        std::unique_lock lock(mtx_);
+        for (uint64_t const key : candidates) {
+            PortId port = 0;
+            if (fdb_.eraseIfBefore(key, cutoff, &port)) {
+                fdbPortIndex_.remove(port);
+                aged.emplace_back(FdbKey(key), port);
+            }
+        }
+    }
+
+    for (auto const& [key, port] : aged) {
+        sai_inform_mac_aged(key.vlan(), key.mac(), static_cast<uint16_t>(port));
+    }
+    return aged.size();
+}
+
 void SwitchState::dumpFdb(FdbTable& outTable) const
 {
     std::shared_lock lock(mtx_);
-    outTable = fdb_;
+
+    outTable.clear();
+    fdb_.forEach([&outTable](uint64_t const key, PortId const port) {
+        outTable.emplace(FdbKey(key), port);
+    });
 }
 
 std::string SwitchState::tostringFdb() const
 {
-    std::shared_lock lock(mtx_);
+    FdbTable fdb;
+    dumpFdb(fdb);
 
-    if (fdb_.empty()) {
+    if (fdb.empty()) {
         return {};
     }
 
     std::string out;
-    out.reserve(fdb_.size() * 100); // Rough preallocation for speed
+    out.reserve(fdb.size() * 100); // Rough preallocation for speed
 
     char lineBuf[80];
 
-    for (auto const& [key, port] : fdb_) {
+    for (auto const& [key, port] : fdb) {
         MacAddress const mac = key.mac();
         MacString const macstr = macToString(mac);
 
@@ -208,3 +809,243 @@ bool SwitchState::getPortPvid(PortId port, VlanId& outPvid) const
     outPvid = it->second;
     return true;
 }
+
+// -----------------------------------------------------------------------------
+// Multicast snooping APIs
+// -----------------------------------------------------------------------------
+
+void SwitchState::noteMcastExpiry(AgingTimer::Tick const expiry)
+{
+    if (expiry < mcastNextExpiry_.load(std::memory_order_relaxed)) {
+        mcastNextExpiry_.store(expiry, std::memory_order_relaxed);
+    }
+}
+
+bool SwitchState::joinMcastGroup(VlanId const vlan, MacAddress const group, PortId port,
+                                 AgingTimer::Tick const expiry)
+{
+    assert(vlan <= MaxVlanId);
+    assert(static_cast<int>(port) < numPorts_);
+
+    if (numPorts_ > PortBitmapMaxPorts) {
+        return false;
+    }
+
+    std::unique_lock lock(mtx_);
+    port = portLag_[port];
+    McastGroup& g = mcastGroups_[FdbKey(vlan, group).packed()];
+    auto const [it, inserted] = g.expiry.insert_or_assign(port, expiry);
+    g.ports |= PortBitmap{1} << port;
+    noteMcastExpiry(expiry);
+    return inserted;
+}
+
+void SwitchState::leaveMcastGroup(VlanId const vlan, MacAddress const group, PortId port,
+                                  AgingTimer::Tick const expiry)
+{
+    assert(vlan <= MaxVlanId);
+    assert(static_cast<int>(port) < numPorts_);
+
+    std::unique_lock lock(mtx_);
+    port = portLag_[port];
+    auto const g = mcastGroups_.find(FdbKey(vlan, group).packed());
+    if (g == mcastGroups_.end()) {
+        return;
+    }
+    auto const member = g->second.expiry.find(port);
+    if (member != g->second.expiry.end() && member->second > expiry) {
+        member->second = expiry;
+        noteMcastExpiry(expiry);
+    }
+}
+
+bool SwitchState::addMcastRouterPort(VlanId const vlan, PortId port, AgingTimer::Tick const expiry)
+{
+    assert(vlan <= MaxVlanId);
+    assert(static_cast<int>(port) < numPorts_);
+
+    if (numPorts_ > PortBitmapMaxPorts) {
+        return false;
+    }
+
+    std::unique_lock lock(mtx_);
+    port = portLag_[port];
+    auto const [it, inserted] = mcastRouterExpiry_.insert_or_assign({vlan, port}, expiry);
+    mcastRouterPorts_[vlan] |= PortBitmap{1} << port;
+    noteMcastExpiry(expiry);
+    return inserted;
+}
+
+bool SwitchState::lookupMcastGroup(VlanId const vlan, MacAddress const group,
+                                   PortBitmap& outPorts) const
+{
+    assert(vlan <= MaxVlanId);
+
+    std::shared_lock lock(mtx_);
+    auto const g = mcastGroups_.find(FdbKey(vlan, group).packed());
+    if (g == mcastGroups_.end()) {
+        return false;
+    }
+    outPorts = g->second.ports | mcastRouterPorts_[vlan];
+    return true;
+}
+
+PortBitmap SwitchState::mcastRouterPorts(VlanId const vlan) const
+{
+    assert(vlan <= MaxVlanId);
+
+    std::shared_lock lock(mtx_);
+    return mcastRouterPorts_[vlan];
+}
+
+size_t SwitchState::ageMcast(AgingTimer::Tick const now)
+{
+    // Nothing expires before the earliest expiry; skip the lock until then.
+    if (now < mcastNextExpiry_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+
+    std::unique_lock lock(mtx_);
+    size_t removed = 0;
+    AgingTimer::Tick next = std::numeric_limits<AgingTimer::Tick>::max();
+
+    for (auto g = mcastGroups_.begin(); g != mcastGroups_.end(); ) {
+        McastGroup& group = g->second;
+        for (auto m = group.expiry.begin(); m != group.expiry.end(); ) {
+            if (m->second <= now) {
+                group.ports &= ~(PortBitmap{1} << m->first);
+                m = group.expiry.erase(m);
+                removed++;
+            } else {
+                next = std::min(next, m->second);
+                ++m;
+            }
+        }
+        g = group.expiry.empty() ? mcastGroups_.erase(g) : std::next(g);
+    }
+
+    for (auto r = mcastRouterExpiry_.begin(); r != mcastRouterExpiry_.end(); ) {
+        auto const [vlan, port] = r->first;
+        if (r->second <= now) {
+            mcastRouterPorts_[vlan] &= ~(PortBitmap{1} << port);
+            r = mcastRouterExpiry_.erase(r);
+            removed++;
+        } else {
+            next = std::min(next, r->second);
+            ++r;
+        }
+    }
+
+    mcastNextExpiry_.store(next, std::memory_order_relaxed);
+    return removed;
+}
+
+std::string SwitchState::tostringMcast() const
+{
+    std::map<FdbKey, PortBitmap> groups;
+    std::map<VlanId, PortBitmap> routers;
+    {
+        std::shared_lock lock(mtx_);
+        for (auto const& [key, group] : mcastGroups_) {
+            groups.emplace(FdbKey(key), group.ports);
+        }
+        for (auto const& [vlanPort, expiry] : mcastRouterExpiry_) {
+            routers[vlanPort.first] = mcastRouterPorts_[vlanPort.first];
+        }
+    }
+
+    auto const portList = [](PortBitmap const ports) {
+        std::string out;
+        for (PortId port = 0; port < PortBitmapMaxPorts; port++) {
+            if ((ports >> port) & 1) {
+                out += (out.empty() ? "" : ",") + std::to_string(port);
+            }
+        }
+        return out.empty() ? std::string("none") : out;
+    };
+
+    std::string out;
+    for (auto const& [vlan, ports] : routers) {
+        out += "mcast vlan=" + std::to_string(vlan) + " router-ports=" + portList(ports) + "\n";
+    }
+    for (auto const& [key, ports] : groups) {
+        out += "mcast vlan=" + std::to_string(key.vlan()) + " group=" +
+               macToString(key.mac()).data() + " ports=" + portList(ports) + "\n";
+    }
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+bool SwitchState::learnNeighbor(VlanId const vlan, IpAddress const& ip, MacAddress const mac,
+                                AgingTimer::Tick const now)
+{
+    assert(vlan <= MaxVlanId);
+
+    NeighborTable::Key const key{vlan, ip};
+    {
+        std::shared_lock lock(mtx_);
+        if (neighbors_.refresh(key, mac, now)) {
+            return false;
+        }
+    }
+
+    std::unique_lock lock(mtx_);
+    auto const [bound, inserted] = neighbors_.emplace(key, mac, now);
+    if (!bound) {
+        neighborOverflows_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (!inserted && *bound == mac) {
+        return false;
+    }
+    *bound = mac;
+    return true;
+}
+
+bool SwitchState::lookupNeighbor(VlanId const vlan, IpAddress const& ip, MacAddress& outMac) const
+{
+    assert(vlan <= MaxVlanId);
+
+    std::shared_lock lock(mtx_);
+    MacAddress const* const mac = neighbors_.find({vlan, ip});
+    if (!mac) {
+        return false;
+    }
+    outMac = *mac;
+    return true;
+}
+
+size_t SwitchState::ageNeighbors(AgingTimer::Tick const now)
+{
+    FdbHashTable::Stamp const cutoff = fdb_aging_cutoff(now, fdbAgingTime());
+    if (cutoff == 0) {
+        return 0;
+    }
+
+    // Find the aged bindings under the read lock, like ageFdb(), so that
+    // lookups go on during the scan; a binding refreshed since stays.
+    std::vector<NeighborTable::Key> candidates;
+    {
+        std::shared_lock lock(mtx_);
+        neighbors_.forEachBefore(cutoff, [&candidates](NeighborTable::Key const& key,
+                                                       MacAddress) {
+            candidates.push_back(key);
+        });
+    }
+    if (candidates.empty()) {
+        return 0;
+    }
+
+    std::unique_lock lock(mtx_);
+    size_t removed = 0;
+    for (NeighborTable::Key const& key : candidates) {
+        removed += neighbors_.eraseIfBefore(key, cutoff);
+    }
+    return removed;
+}
+
+size_t SwitchState::neighborCount() const
+{
+    std::shared_lock lock(mtx_);
+    return neighbors_.size();
+}
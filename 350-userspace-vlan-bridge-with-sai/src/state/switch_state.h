@@ -1,12 +1,24 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <map>
+#include <memory>
 #include <utility>
+#include <set>
 #include <shared_mutex>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include "aging_timer.h"
+#include "fdb_hash_table.h"
+#include "fdb_port_index.h"
+#include "neighbor_table.h"
+#include "port_config.h"
 
 // -----------------------------------------------------------------------------
 // Constants
@@ -28,7 +40,27 @@ enum {
     MacStringSize = 18,
 
     DefaultVlanId = 1,
-    MaxVlanId = 4095
+    MaxVlanId = 4095,
+
+    // 802.1Q tag: TPID, then TCI of PCP (3 bits), DEI (1 bit), VID (12 bits).
+    // Provider (802.1ad) ports use the S-tag TPID for their outer tag.
+    EthTypeVlan = 0x8100,
+    EthTypeQinQ = 0x88a8,
+    VlanTagByteLen = 4,
+    VlanIdMask = 0x0fff,
+    VlanPcpDeiMask = 0xf000,
+
+    // FDB entries preallocated per configured port
+    FdbEntriesPerPort = 1024,
+
+    // Unlearned sources remembered by reportMac(); preallocated
+    MaxReportedMacs = 4096,
+
+    // ARP / ND bindings of the neighbor table; preallocated
+    MaxNeighbors = 4096,
+
+    // Hash buckets of a LAG, each mapped to one member; power of two
+    LagBuckets = 256
 };
 
 // -----------------------------------------------------------------------------
@@ -37,6 +69,7 @@ enum {
 typedef uint16_t VlanId;       // VLAN identifier
 typedef uint32_t PortId;       // Logical port identifier
 typedef uint64_t MacAddress;   // Packed 48-bit MAC
+typedef std::array<uint8_t, 16> IpAddress;  // IPv6, or IPv4 mapped (::ffff:a.b.c.d)
 
 // std::array is used instead of a raw C-array (char[18]) because it allows
 // the function to safely return the array by value without it decaying to a pointer.
@@ -55,10 +88,118 @@ typedef std::map<VlanId, VlanMemberList> VlanTable;
 // Port → PVID
 typedef std::map<PortId, VlanId> PortPvidTable;
 
+// Bitmap of ports, bit p is set for port p; covers switches up to 64 ports
+typedef uint64_t PortBitmap;
+
+enum {
+    PortBitmapMaxPorts = 64
+};
+
+// Bitmap that lets every port through, on switches of any size
+constexpr PortBitmap AllPortsBitmap = ~PortBitmap{0};
+
+// True if bitmap holds port; AllPortsBitmap holds ports past
+// PortBitmapMaxPorts too
+inline bool bitmap_has_port(PortBitmap const bitmap, PortId const port)
+{
+    return bitmap == AllPortsBitmap || ((bitmap >> port) & 1) != 0;
+}
+
+// Membership of a port in a VLAN
+enum class VlanTagging : uint8_t {
+    None,       // Not a member
+    Untagged,   // Member, frames egress without tag
+    Tagged      // Member, frames egress with 802.1Q tag
+};
+
+// Source MAC learning of frames received on a port; the subset of the SAI
+// bridge port FDB learning modes that forward the frame
+enum class LearnMode : uint8_t {
+    Hardware,   // Learn into the FDB (default)
+    Disable,    // Do not learn
+    CpuLog,     // Do not learn; log each new source on the console
+    Notify      // Do not learn; notify the management plane of each new source
+};
+
+// Set of egress ports
+struct EgressPorts {
+    std::vector<PortId> ports;       // Egress ports
+    PortBitmap          bitmap = 0;  // Same ports as bitmap, if the switch fits
+};
+
+// Flood egress ports for one (VLAN, ingress port) pair, split by how the
+// frame leaves them, so that the dataplane sets the tag once per group
+// instead of deciding per port
+struct FloodSet {
+    EgressPorts untagged;
+    EgressPorts tagged;
+};
+
+// Flood sets of one VLAN, indexed by ingress port, the tagging of each
+// port in the VLAN, and how the VLAN's frames are learned on each port.
+// Rebuilt as a whole whenever the VLAN membership or learning changes and
+// never modified afterwards, so the dataplane can hold on to it without
+// copying.
+struct VlanFloodSets {
+    std::vector<FloodSet>    byIngress;  // Ingress port → flood set
+    std::vector<VlanTagging> tagging;    // Port → membership
+    std::vector<LearnMode>   learning;   // Ingress port → learning of the
+                                         // port's mode and the VLAN's
+
+    FloodSet const& operator[](PortId const ingress) const { return byIngress[ingress]; }
+};
+typedef std::shared_ptr<VlanFloodSets const> VlanFloodSetsPtr;
+
 
 // Extract 48-bit MAC starting from p
 MacAddress extract_mac(uint8_t const * const p);
 
+// Extract 16-bit ethertype or TPID starting from p
+inline uint16_t extract_ethertype(uint8_t const* const p)
+{
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+// True if type is the TPID of an 802.1Q C-tag or 802.1ad S-tag
+inline bool is_vlan_tpid(uint16_t const type)
+{
+    return type == EthTypeVlan || type == EthTypeQinQ;
+}
+
+// Offset of the payload of the frame of len bytes, behind both MACs, up to
+// two VLAN tags, and the ethertype, which is the 2 bytes before it; len if
+// the frame ends before its payload starts
+inline size_t payload_offset(uint8_t const* const frame, size_t const len)
+{
+    size_t offset = 2 * MacAddressByteLen;
+    for (int tags = 0; tags < 2 && offset + 2 <= len; tags++) {
+        if (!is_vlan_tpid(extract_ethertype(frame + offset))) {
+            break;
+        }
+        offset += VlanTagByteLen;
+    }
+    offset += 2;
+    return (offset <= len) ? offset : len;
+}
+
+// Address class of a MAC, as seen by the forwarding logic
+enum class MacClass : uint8_t {
+    Unicast,
+    Multicast,
+    Broadcast
+};
+
+// Classify MAC by its I/G bit (least significant bit of the first octet).
+// Group addresses can never be learned, so they never hit the FDB.
+inline MacClass classify_mac(MacAddress const mac)
+{
+    if (mac == MAC_ADDRESS_MASK) {
+        return MacClass::Broadcast;
+    }
+    bool const group = (mac >> (MAC_ADDRESS_BITS - 8)) & 1;
+    return group ? MacClass::Multicast : MacClass::Unicast;
+}
+
 /**
  * @brief Converts a 64-bit unsigned integer (representing a 48-bit MAC address)
  * into a colon-separated hexadecimal string format (XX:XX:XX:XX:XX:XX).
@@ -74,6 +215,10 @@ MacString macToString(MacAddress const mac);
 
 // -----------------------------------------------------------------------------
 // FdbKey: packed (VLAN << 48) | MAC
+//
+// The VLAN is the one the frame was classified into: on provider ports the
+// S-VLAN, with any customer tag inside left as payload, so the key holds a
+// single VID for single- and double-tagged frames alike.
 // -----------------------------------------------------------------------------
 class FdbKey {
 public:
@@ -83,6 +228,11 @@ public:
                (mac & MAC_ADDRESS_MASK);
     }
 
+    explicit FdbKey(uint64_t packed)           // Construct from packed key
+        : key_{packed}
+    {
+    }
+
     bool operator<(const FdbKey& other) const  // Needed for std::map
     {
         return key_ < other.key_;
@@ -98,14 +248,56 @@ public:
         return key_ & MAC_ADDRESS_MASK;
     }
 
+    uint64_t packed() const                    // Packed VLAN+MAC key
+    {
+        return key_;
+    }
+
 private:
     uint64_t key_;                             // Packed VLAN+MAC key
 };
 
 
-// Entire FDB map
+static_assert(sizeof(FdbHashTable::Value) == sizeof(PortId), "FDB value holds a PortId");
+static_assert(sizeof(FdbHashTable::Stamp) == sizeof(AgingTimer::Tick), "FDB stamp holds a Tick");
+static_assert(sizeof(NeighborTable::Stamp) == sizeof(AgingTimer::Tick),
+              "neighbor stamp holds a Tick");
+static_assert(std::is_same_v<NeighborKey::Ip, IpAddress>, "neighbor key holds an IpAddress");
+
+// Learn or update (vlan, mac) → port in fdb, stamped as seen at now;
+// return (learned, moved). If index is given, it follows the entry to its
+// new port. The caller serializes access to fdb.
+std::pair<bool, bool> learn_fdb_entry(FdbHashTable& fdb, VlanId vlan, MacAddress mac, PortId port,
+                                      AgingTimer::Tick now, FdbPortIndex* index = nullptr);
+
+// Stamp before which FDB entries have aged out at now, with aging time
+// agingSecs; 0, which no entry is stamped before, if agingSecs is 0 or
+// no entry can be that old yet
+inline FdbHashTable::Stamp fdb_aging_cutoff(AgingTimer::Tick const now, uint32_t const agingSecs)
+{
+    return (agingSecs != 0 && now >= agingSecs) ? now - agingSecs + 1 : 0;
+}
+
+// Remove the entries of fdb stamped before cutoff and report them to the
+// management plane as aged; return the number removed. The caller
+// serializes access to fdb, and index, if given, is updated too.
+size_t age_fdb_entries(FdbHashTable& fdb, FdbHashTable::Stamp cutoff,
+                       FdbPortIndex* index = nullptr);
+
+// Entire FDB map, sorted; used for dumps
 typedef std::map<FdbKey, PortId> FdbTable;
 
+// Key of a batched FDB lookup
+struct FdbLookupKey {
+    VlanId     vlan;
+    MacAddress mac;
+};
+
+enum {
+    // Keys whose buckets are prefetched together by lookupFdbBatch()
+    FdbLookupBatchSize = 32
+};
+
 // -----------------------------------------------------------------------------
 // SwitchState: central in-memory model for VLAN, FDB, port state
 // -----------------------------------------------------------------------------
@@ -114,23 +306,167 @@ public:
     // Constructor ensures object is fully initialized
     SwitchState();
 
+    // Set the ports of this switch and clear all state; called once at
+    // startup, before the dataplane and management threads run. Sizes
+    // the tables for the port count.
+    void configurePorts(PortConfig const& ports);
+
     // Return the number of ports of this switch.
     int numPorts() const;
 
+    // Settings of port
+    PortSettings const& portSettings(PortId port) const;
+
+    // Set the operational state of port, e.g. down if its interface is
+    // missing or has no carrier. A down port is left out of all flood
+    // sets. If port is a LAG member, its LAG is rebalanced, and
+    // outLagMoved, if given, receives the number of hash buckets that
+    // moved to another member. Return true if the state changed.
+    bool setPortOperUp(PortId port, bool up, size_t* outLagMoved = nullptr);
+
+    // True if port is operationally up
+    bool isPortOperUp(PortId port) const;
+
+    // -------------------------------------------------------------------------
+    // Link aggregation
+    //
+    // Ports with the same lag setting form a LAG, which stands in for its
+    // members as one port: the LAG port, its lowest member port id. The FDB
+    // learns sources received on any member at the LAG port, and flood sets
+    // hold the LAG port once, so a flood goes to one member. The dataplane
+    // picks the egress member of a LAG port by the frame's flow hash from
+    // LagBuckets hash buckets. When a member goes down, only its buckets
+    // move to the other members; when one comes up, it takes over buckets
+    // from the members with the most. Members are expected to share their
+    // VLAN config; the LAG port's tagging applies to the LAG.
+    //
+    // The LAGs are set by configurePorts(), so the lookups below take no
+    // lock.
+    // -------------------------------------------------------------------------
+
+    // LAG port of port if port is a LAG member, else port itself
+    PortId lagPort(PortId const port) const { return portLag_[port]; }
+
+    // True if port is the LAG port of a LAG
+    bool isLag(PortId const port) const { return lagOf_[port] != nullptr; }
+
+    // Member of the LAG of lagPort that carries flows with hash
+    PortId lagMember(PortId const lagPort, uint32_t const hash) const
+    {
+        return lagOf_[lagPort]->buckets[hash & (LagBuckets - 1)].load(std::memory_order_relaxed);
+    }
+
+    // Members of every LAG, by LAG port
+    std::map<PortId, VlanMemberList> lagMembers() const;
+
+    // True if port, or any member of its LAG, is operationally up
+    bool isLagUp(PortId port) const;
+
+    // Set the ifindex of the interface port is bound to; 0 if unbound
+    void setPortIfindex(PortId port, int ifindex);
+
+    // Ifindex of the interface port is bound to; 0 if unbound
+    int portIfindex(PortId port) const;
+
     // Create VLAN (if not exist)
     void createVlan(VlanId vlan);
 
-    // Add port to VLAN
+    // Add port to VLAN. An untagged member gets the VLAN as its PVID; a
+    // tagged member sends and receives the VLAN's frames with 802.1Q tag.
     void addVlanMember(VlanId vlan, PortId port, bool tagged);
 
+    // Enable or disable source MAC learning in VLAN, for all its ports
+    // (SAI_VLAN_ATTR_LEARN_DISABLE); return false if the VLAN does not exist
+    bool setVlanLearning(VlanId vlan, bool enabled);
+
+    // Set the learning mode of port, for frames of VLANs with learning
+    // enabled (SAI_BRIDGE_PORT_ATTR_FDB_LEARNING_MODE)
+    void setPortLearnMode(PortId port, LearnMode mode);
+
     // Get VLAN members; return true if VLAN exists
     bool getVlanMembers(VlanId vlan, VlanMemberList& outMembers) const;
 
-    // Learn or update FDB entry
-    std::pair<bool, bool> learnMac(VlanId vlan, MacAddress mac, PortId port);
-
-    // Lookup FDB entry; return true if found
-    bool lookupFdb(VlanId vlan, MacAddress mac, PortId& outPort) const;
+    // Get precomputed flood sets of VLAN; if the VLAN does not exist,
+    // then the flood sets cover all ports of the switch
+    VlanFloodSetsPtr getFloodSets(VlanId vlan) const;
+
+    // Learn or update FDB entry, at the LAG port if port is a LAG member,
+    // stamped as seen at seen (AgingTimer::Never for an entry that does
+    // not age out)
+    std::pair<bool, bool> learnMac(VlanId vlan, MacAddress mac, PortId port,
+                                   AgingTimer::Tick seen);
+
+    // Classify a frame received on port into a VLAN: by the VID of its
+    // outer tag if that has the port's TPID and a non-zero VID, else by the
+    // port's PVID (default VLAN if none). outLearn receives how its source
+    // MAC is learned, so learnMac() is only called for LearnMode::Hardware.
+    // Return false if the frame is to be dropped, i.e. it is tagged for a
+    // VLAN the port is not a member of.
+    bool classifyVlan(PortId port, bool tagged, VlanId vid, VlanId& outVlan,
+                      LearnMode& outLearn) const;
+
+    // Record a source MAC seen on port but not learned because of its
+    // learning mode; return true if it is new, i.e. not seen on port
+    // before; LAG members count as their LAG port. With LearnMode::Notify,
+    // a new source is also reported to the management plane as learned.
+    // Sources seen are forgotten whenever a learning mode changes, and
+    // after the FDB aging time, so a source still sending is reported
+    // again. Once MaxReportedMacs are remembered, a new source is counted
+    // as an overflow and not reported, so the table never grows on the
+    // dataplane thread.
+    bool reportMac(VlanId vlan, MacAddress mac, PortId port, LearnMode mode);
+
+    // Forget the sources seen that aged out at now, so that they are
+    // reported again; return the number forgotten
+    size_t ageReportedMacs(AgingTimer::Tick now);
+
+    // New sources not reported because MaxReportedMacs were remembered
+    uint64_t reportOverflows() const { return reportOverflows_.load(std::memory_order_relaxed); }
+
+    // True if frames of vlan leave port with a tag of the port's TPID
+    bool isTaggedEgress(VlanId vlan, PortId port) const;
+
+    // Lookup FDB entry; return true if found. If outTagged is given, it
+    // tells whether frames of vlan leave the port found with 802.1Q tag.
+    bool lookupFdb(VlanId vlan, MacAddress mac, PortId& outPort, bool* outTagged = nullptr) const;
+
+    // Lookup FDB entries of count keys under one lock. All keys of a
+    // batch are hashed and their buckets prefetched before any of them
+    // is resolved, so the memory latency of the lookups overlaps.
+    // outFound[i] tells whether keys[i] was found, and if so, outPorts[i]
+    // holds its port and outTagged[i], if given, its egress tagging.
+    // Return the number of keys found.
+    size_t lookupFdbBatch(FdbLookupKey const* keys, size_t count,
+                          PortId* outPorts, bool* outFound, bool* outTagged = nullptr) const;
+
+    // Remove all FDB entries pointing at port, in O(entries on port);
+    // return the number removed. The flush is also counted, so that the
+    // sharded dataplane flushes its FDB slices too (see fdbFlushes()).
+    size_t flushFdbPort(PortId port);
+
+    // Number of flushFdbPort() calls so far, of any port; cheap enough to
+    // read on every pass of a dataplane loop
+    uint64_t fdbFlushes() const { return fdbFlushes_.load(std::memory_order_acquire); }
+
+    // Number of flushFdbPort() calls so far, per port
+    std::vector<uint64_t> portFlushes() const;
+
+    // Preallocate the FDB for entries, so that learning up to that many
+    // MACs allocates no memory
+    void reserveFdb(size_t entries);
+
+    // Set the time after which an FDB entry that no frame refreshed is
+    // removed (SAI_SWITCH_ATTR_FDB_AGING_TIME), in seconds; 0 disables
+    // aging
+    void setFdbAgingTime(uint32_t secs);
+
+    // FDB aging time, in seconds; 0 if disabled
+    uint32_t fdbAgingTime() const { return fdbAgingSecs_.load(std::memory_order_relaxed); }
+
+    // Remove the FDB entries that aged out at now, and report them to the
+    // management plane as aged; return the number removed. The entries are
+    // found under the read lock, so frames keep flowing during the scan.
+    size_t ageFdb(AgingTimer::Tick now);
 
     // Dump FDB table
     void dumpFdb(FdbTable& outTable) const;
@@ -141,17 +477,173 @@ public:
     // Get port PVID; return true if available
     bool getPortPvid(PortId port, VlanId& outPvid) const;
 
+    // -------------------------------------------------------------------------
+    // Multicast snooping (see mcast_snooping.h)
+    //
+    // The group table maps (VLAN, group MAC) to the ports with listeners
+    // of the group, and each VLAN has its multicast router ports, where
+    // queries came in. Frames to a registered group only go to its ports
+    // and the router ports of its VLAN; frames to other groups flood.
+    // Memberships and router ports expire at the time they are given; LAG
+    // members count as their LAG port. Ports are kept as PortBitmap, so
+    // switches of more than PortBitmapMaxPorts ports register no groups
+    // and flood all multicast.
+    // -------------------------------------------------------------------------
+
+    // Add port to the listeners of group in vlan, or refresh it, until
+    // expiry; return true if port is new to the group
+    bool joinMcastGroup(VlanId vlan, MacAddress group, PortId port, AgingTimer::Tick expiry);
+
+    // Let the membership of port in group of vlan expire at expiry, if it
+    // would expire later
+    void leaveMcastGroup(VlanId vlan, MacAddress group, PortId port, AgingTimer::Tick expiry);
+
+    // Make port a multicast router port of vlan, or refresh it, until
+    // expiry; return true if it is new
+    bool addMcastRouterPort(VlanId vlan, PortId port, AgingTimer::Tick expiry);
+
+    // Ports that frames of vlan to group go to: the listeners of group
+    // and the router ports of vlan. Return false if group is not
+    // registered, i.e. its frames flood.
+    bool lookupMcastGroup(VlanId vlan, MacAddress group, PortBitmap& outPorts) const;
+
+    // Multicast router ports of vlan
+    PortBitmap mcastRouterPorts(VlanId vlan) const;
+
+    // Remove the memberships and router ports that expired at now; return
+    // the number removed
+    size_t ageMcast(AgingTimer::Tick now);
+
+    // String representation of the group table and router ports
+    std::string tostringMcast() const;
+
+    // -------------------------------------------------------------------------
+    // ARP / ND suppression (see arp_suppression.h)
+    //
+    // The neighbor table binds (VLAN, IP) to the MAC that answers for it,
+    // as snooped from ARP and ND. A binding only says which MAC to send a
+    // request to; where that MAC is comes from the FDB. Bindings that no
+    // frame refreshed within the FDB aging time are removed. The table
+    // holds up to MaxNeighbors bindings, also when aging is off.
+    // -------------------------------------------------------------------------
+
+    // Bind ip in vlan to mac, or refresh the binding, at now; return true
+    // if the binding is new or its MAC changed. A refresh only takes the
+    // read lock. Once MaxNeighbors are bound, a new binding is counted as
+    // an overflow and dropped.
+    bool learnNeighbor(VlanId vlan, IpAddress const& ip, MacAddress mac, AgingTimer::Tick now);
+
+    // MAC bound to ip in vlan; return false if none
+    bool lookupNeighbor(VlanId vlan, IpAddress const& ip, MacAddress& outMac) const;
+
+    // Remove the bindings that aged out at now; return the number removed
+    size_t ageNeighbors(AgingTimer::Tick now);
+
+    // Number of bindings
+    size_t neighborCount() const;
+
+    // New bindings dropped because MaxNeighbors were bound
+    uint64_t neighborOverflows() const
+    {
+        return neighborOverflows_.load(std::memory_order_relaxed);
+    }
+
 private:
     // Clear state.
     void reset();
 
+    // List of all ports
+    VlanMemberList allPorts() const;
+
+    // Build flood sets of vlan from its member list
+    VlanFloodSetsPtr buildFloodSets(VlanId vlan, VlanMemberList const& members) const;
+
+    // True if frames of vlan leave port tagged; caller must hold mtx_
+    bool taggedEgressLocked(VlanId vlan, PortId port) const;
+
+    // Rebuild flood sets of one VLAN; caller must hold mtx_
+    void rebuildFloodSets(VlanId vlan);
+
+    // Rebuild flood sets of all VLANs; caller must hold mtx_
+    void rebuildAllFloodSets();
+
+    // LAG with its hash buckets
+    struct Lag {
+        VlanMemberList                                 members;
+        std::array<std::atomic<PortId>, LagBuckets>    buckets;   // Hash → member
+    };
+
+    // Set up the LAGs of the port settings; caller must hold mtx_
+    void configureLags();
+
+    // Move the buckets of down members of lag to up members, then even
+    // out the bucket counts of the up members; return the buckets moved.
+    // Caller must hold mtx_.
+    static size_t rebalanceLag(Lag& lag, std::vector<uint8_t> const& portOperUp);
+
+    // True if port or a member of its LAG is up; caller must hold mtx_
+    bool lagUpLocked(PortId port) const;
+
+    // Forget all sources seen, keeping room for MaxReportedMacs; caller
+    // must hold mtx_
+    void clearReportedMacs();
+
+    // Listeners of a multicast group
+    struct McastGroup {
+        std::map<PortId, AgingTimer::Tick>  expiry;     // Port → membership expiry
+        PortBitmap                          ports = 0;  // Same ports
+    };
+
+    // Lower the next multicast expiry to expiry; caller must hold mtx_
+    void noteMcastExpiry(AgingTimer::Tick expiry);
+
 private:
     mutable std::shared_mutex mtx_;  // Read/write lock
 
-    int const      numPorts_;        // Number of ports
+    int            numPorts_;        // Number of ports
+    PortConfig     ports_;           // Port → settings
+    std::vector<uint8_t> portOperUp_; // Port → operationally up
+    std::vector<int>     portIfindex_; // Port → bound ifindex, 0 if none
+    std::vector<PortId>  portLag_;     // Port → LAG port, itself if none
+    std::vector<std::unique_ptr<Lag>>
+                         lagOf_;       // LAG port → LAG, null for others
+
+    FdbPortIndex   fdbPortIndex_;    // Port → FDB keys, for flushing a port
+    std::vector<uint64_t> portFlushes_; // Port → FDB flushes of the port
+    std::atomic<uint64_t> fdbFlushes_{0}; // FDB flushes of all ports
     VlanTable      vlanMembers_;     // VLAN → ports
-    FdbTable       fdb_;             // (VLAN,MAC) → port
+    std::set<std::pair<VlanId, PortId>>
+                   taggedMembers_;   // (VLAN, port) of tagged members
+    std::set<VlanId> learnDisabledVlans_; // VLANs with learning disabled
+    std::vector<LearnMode> portLearnMode_; // Port → learning mode
+    BoundedFdbHashTable
+                   reportedMacs_{MaxReportedMacs}; // (VLAN,MAC) → port,
+                                     // sources seen but not learned
+    std::atomic<uint64_t> reportOverflows_{0}; // Sources not reported,
+                                               // reportedMacs_ full
+    FdbHashTable   fdb_;             // (VLAN,MAC) → port
     PortPvidTable  portPvid_;        // Port → PVID
+
+    std::array<VlanFloodSetsPtr, MaxVlanId + 1>
+                   floodSets_;       // VLAN → flood sets
+    VlanFloodSetsPtr allPortsFloodSets_; // Flood sets for unknown VLAN
+
+    std::atomic<uint32_t> fdbAgingSecs_{0}; // FDB aging time; 0: no aging,
+                                            // the SAI default
+
+    std::unordered_map<uint64_t, McastGroup>
+                   mcastGroups_;     // (VLAN, group MAC) → listeners
+    std::map<std::pair<VlanId, PortId>, AgingTimer::Tick>
+                   mcastRouterExpiry_; // (VLAN, router port) → expiry
+    std::array<PortBitmap, MaxVlanId + 1>
+                   mcastRouterPorts_;  // VLAN → router ports
+    std::atomic<AgingTimer::Tick>
+                   mcastNextExpiry_;   // No membership or router port
+                                       // expires before
+
+    NeighborTable  neighbors_{MaxNeighbors}; // (VLAN, IP) → MAC
+    std::atomic<uint64_t> neighborOverflows_{0}; // Bindings dropped,
+                                                 // neighbors_ full
 };
 
 
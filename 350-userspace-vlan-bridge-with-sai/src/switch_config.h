@@ -1,4 +0,0 @@
-// Generated by tools/tools/setup.sh
-enum {
-    NumSwitchPorts = 4
-};
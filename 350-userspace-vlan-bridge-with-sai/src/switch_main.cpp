@@ -1,15 +1,170 @@
+#include <algorithm>
 #include <thread>
+#include <cstdio>
 #include <iostream>
+#include <string>
+
+#include "dataplane/switch_dataplane.h"
+#include "state/port_config.h"
+#include "state/switch_state.h"
 
-void run_dataplane();
 void run_mgmtplane();
 
-int main()
+static void
+usage(char const* prog)
 {
-    std::cout << "[MAIN] Starting uswitch...\n";
+    std::cerr << "Usage: " << prog << " [--port-config <file> | --ports <interface>,...]\n"
+              << "       [--generic-dataplane] [--vector] [--port-weight <port>=<weight>]...\n"
+              << "       [--pipelined [--rx-threads <n>] [--tx-threads <n>]] [--sharded <n>]\n"
+              << "       [--busy-poll [--sched-fifo <priority>]] [--adaptive [--idle-threshold <usecs>]]\n"
+              << "       [--cpus <cpu>,...]\n"
+              << "  --port-config        Load the ports from a file (default " << DefaultPortConfigFile << ")\n"
+              << "  --ports              Use these interfaces as ports 0, 1, ...\n"
+              << "  --generic-dataplane  Do not use a port-count specialized dataplane core\n"
+              << "  --vector             Process frames in vectors through a node graph\n"
+              << "  --port-weight        Ingress scheduler weight of a port (default 1, or\n"
+              << "                       from the port config)\n"
+              << "  --pipelined          Run RX, forwarding, and TX on separate threads\n"
+              << "  --rx-threads         RX threads of the pipelined dataplane (default 1)\n"
+              << "  --tx-threads         TX threads of the pipelined dataplane (default 1)\n"
+              << "  --sharded            Run n workers, each owning a slice of the FDB\n"
+              << "  --busy-poll          Spin on the ports instead of sleeping, with memory\n"
+              << "                       locked and tables prefaulted\n"
+              << "  --sched-fifo         SCHED_FIFO priority of the dataplane threads with\n"
+              << "                       --busy-poll\n"
+              << "  --adaptive           Spin while frames flow, nap, then block when idle\n"
+              << "  --idle-threshold     Idle time before --adaptive blocks (default 1000 us)\n"
+              << "  --cpus               Cores to pin the dataplane threads to, in the order\n"
+              << "                       RX threads, forwarding thread, TX threads; or\n"
+              << "                       one per sharded worker\n";
+}
+
+// Parse a positive count
+static bool
+parse_count(std::string const& value, uint32_t& count)
+{
+    unsigned n = 0;
+    char extra = 0;
+    if (std::sscanf(value.c_str(), "%u%c", &n, &extra) != 1 || n == 0) {
+        return false;
+    }
+    count = n;
+    return true;
+}
+
+// Parse "<cpu>,<cpu>,..." into config.cpus
+static bool
+parse_cpus(std::string const& value, DataplaneConfig& config)
+{
+    config.cpus.clear();
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos) {
+            end = value.size();
+        }
+        unsigned cpu = 0;
+        char extra = 0;
+        std::string const item = value.substr(start, end - start);
+        if (std::sscanf(item.c_str(), "%u%c", &cpu, &extra) != 1) {
+            return false;
+        }
+        config.cpus.push_back(static_cast<int>(cpu));
+        start = end + 1;
+    }
+    return true;
+}
+
+// Parse "<port>=<weight>" into config.portWeights
+static bool
+parse_port_weight(std::string const& value, DataplaneConfig& config)
+{
+    unsigned port = 0;
+    unsigned weight = 0;
+    char extra = 0;
+    if (std::sscanf(value.c_str(), "%u=%u%c", &port, &weight, &extra) != 2 || weight == 0) {
+        return false;
+    }
+    if (config.portWeights.size() <= port) {
+        config.portWeights.resize(port + 1, 0);
+    }
+    config.portWeights[port] = weight;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    DataplaneConfig dpConfig;
+    std::string portConfigFile = DefaultPortConfigFile;
+    std::string portList;
+    for (int i = 1; i < argc; i++) {
+        std::string const arg = argv[i];
+        if (arg == "--port-config" && i + 1 < argc) {
+            portConfigFile = argv[++i];
+        } else if (arg == "--ports" && i + 1 < argc) {
+            portList = argv[++i];
+        } else if (arg == "--generic-dataplane") {
+            dpConfig.genericDataplane = true;
+        } else if (arg == "--vector") {
+            dpConfig.vectorMode = true;
+        } else if (arg == "--port-weight" && i + 1 < argc &&
+                   parse_port_weight(argv[i + 1], dpConfig)) {
+            i++;
+        } else if (arg == "--pipelined") {
+            dpConfig.pipelined = true;
+        } else if (arg == "--rx-threads" && i + 1 < argc &&
+                   parse_count(argv[i + 1], dpConfig.rxThreads)) {
+            i++;
+        } else if (arg == "--tx-threads" && i + 1 < argc &&
+                   parse_count(argv[i + 1], dpConfig.txThreads)) {
+            i++;
+        } else if (arg == "--sharded" && i + 1 < argc &&
+                   parse_count(argv[i + 1], dpConfig.shards)) {
+            i++;
+        } else if (arg == "--busy-poll") {
+            dpConfig.busyPoll = true;
+        } else if (arg == "--sched-fifo" && i + 1 < argc &&
+                   parse_count(argv[i + 1], dpConfig.schedFifoPriority)) {
+            i++;
+        } else if (arg == "--adaptive") {
+            dpConfig.adaptivePoll = true;
+        } else if (arg == "--idle-threshold" && i + 1 < argc &&
+                   parse_count(argv[i + 1], dpConfig.adaptiveIdleUsecs)) {
+            i++;
+        } else if (arg == "--cpus" && i + 1 < argc &&
+                   parse_cpus(argv[i + 1], dpConfig)) {
+            i++;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    PortConfig ports;
+    std::string err;
+    bool const loaded = portList.empty()
+        ? load_port_config(portConfigFile, ports, err)
+        : parse_port_list(portList, ports, err);
+    if (!loaded) {
+        std::cerr << "[MAIN] " << err << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+
+    // --port-weight overrides the weights of the port config.
+    dpConfig.portWeights.resize(std::max(dpConfig.portWeights.size(), ports.size()), 0);
+    for (size_t port = 0; port < ports.size(); port++) {
+        if (dpConfig.portWeights[port] == 0) {
+            dpConfig.portWeights[port] = ports[port].weight;
+        }
+    }
+
+    g_switch_state.configurePorts(ports);
+
+    std::cout << "[MAIN] Starting uswitch with " << ports.size() << " ports...\n";
 
     std::thread mp_thread(run_mgmtplane);
-    std::thread dp_thread(run_dataplane);
+    std::thread dp_thread(run_dataplane, dpConfig);
 
     mp_thread.join();
     dp_thread.join();
@@ -0,0 +1,128 @@
+// Header parser test: every parse_headers() variant the CPU supports
+// (scalar, SSE4, AVX2) against extract_mac() and extract_ethertype(), on
+// untagged, 802.1Q, 802.1ad and QinQ frames, at every burst size up to
+// MaxHeaderBurst. Odd burst sizes cover the single-frame tail of AVX2.
+//
+//     header_parse_test
+
+#include <cstdio>
+#include <vector>
+
+#include "dataplane/header_parse.h"
+#include "dataplane/switch_dataplane.h"
+#include "state/switch_state.h"
+
+enum {
+    // Frame buffers are longer than HeaderParseReadLen, as packet buffers are
+    TestFrameLen = 64,
+
+    EtherTypeIpv4 = 0x0800,
+    EtherTypeIpv6 = 0x86dd,
+    TpidCtag      = 0x8100,
+    TpidStag      = 0x88a8
+};
+
+// Tag stacks of the test frames, outer first; 0 ends the stack
+static uint16_t const TagStacks[][2] = {
+    {0,        0},
+    {TpidCtag, 0},
+    {TpidStag, 0},
+    {TpidStag, TpidCtag},
+    {TpidCtag, TpidCtag},
+};
+
+static void put_u16(uint8_t* const p, uint16_t const v)
+{
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+// Frame n: MACs and TCIs that differ per frame, the tag stack n picks, and
+// an IPv4 or IPv6 payload
+static std::vector<uint8_t> make_frame(size_t const n)
+{
+    std::vector<uint8_t> frame(TestFrameLen);
+    for (size_t b = 0; b < frame.size(); b++) {
+        frame[b] = static_cast<uint8_t>(0x11 * n + 0x3d * b + 1);
+    }
+    uint16_t const* const tags = TagStacks[n % (sizeof(TagStacks) / sizeof(TagStacks[0]))];
+    uint8_t* p = frame.data() + 2 * MacAddressByteLen;
+    for (int t = 0; t < 2 && tags[t] != 0; t++) {
+        put_u16(p, tags[t]);
+        p += VlanTagByteLen;
+    }
+    put_u16(p, (n % 2 == 0) ? EtherTypeIpv4 : EtherTypeIpv6);
+    return frame;
+}
+
+// Check entry i of out against the scalar helpers; false and a message on
+// mismatch
+static bool check_frame(char const* const variant, size_t const count, size_t const i,
+                        uint8_t const* const p, HeaderBurst const& out)
+{
+    uint16_t const outer = extract_ethertype(p + 2 * MacAddressByteLen);
+    bool const tagged = is_vlan_tpid(outer);
+    uint16_t const tci = tagged ? extract_ethertype(p + 2 * MacAddressByteLen + 2) : 0;
+
+    bool const ok = out.dmac[i] == extract_mac(p) &&
+                    out.smac[i] == extract_mac(p + MacAddressByteLen) &&
+                    out.tagged[i] == tagged && out.tci[i] == tci &&
+                    out.ethtype[i] == extract_payload_ethertype(p);
+    if (!ok) {
+        std::printf("FAIL %s count=%zu frame=%zu: dmac %012llx smac %012llx "
+                    "tagged %d tci %04x ethtype %04x\n",
+                    variant, count, i,
+                    static_cast<unsigned long long>(out.dmac[i]),
+                    static_cast<unsigned long long>(out.smac[i]),
+                    out.tagged[i], out.tci[i], out.ethtype[i]);
+    }
+    return ok;
+}
+
+int main()
+{
+    struct Variant {
+        ParseVariant id;
+        char const*  name;
+    };
+    Variant const variants[] = {
+        {ParseVariant::Scalar, "scalar"},
+        {ParseVariant::Sse4,   "sse4"},
+        {ParseVariant::Avx2,   "avx2"},
+    };
+
+    std::vector<std::vector<uint8_t>> frames;
+    std::vector<uint8_t const*> framePtrs;
+    for (size_t n = 0; n < MaxHeaderBurst; n++) {
+        frames.push_back(make_frame(n));
+    }
+    for (std::vector<uint8_t> const& frame : frames) {
+        framePtrs.push_back(frame.data());
+    }
+
+    int failures = 0;
+    for (Variant const& variant : variants) {
+        if (!parse_variant_supported(variant.id)) {
+            std::printf("SKIP %s: not supported by this CPU\n", variant.name);
+            continue;
+        }
+        int const before = failures;
+        for (size_t count = 1; count <= MaxHeaderBurst; count++) {
+            HeaderBurst out;
+            parse_headers_variant(variant.id, framePtrs.data(), count, out);
+            for (size_t i = 0; i < count; i++) {
+                failures += !check_frame(variant.name, count, i, framePtrs[i], out);
+            }
+        }
+        std::printf("%s %s\n", failures == before ? "PASS" : "FAIL", variant.name);
+    }
+
+    // parse_headers() itself, with the variant picked at startup
+    HeaderBurst out;
+    parse_headers(framePtrs.data(), MaxHeaderBurst, out);
+    for (size_t i = 0; i < MaxHeaderBurst; i++) {
+        failures += !check_frame(header_parser_name(), MaxHeaderBurst, i, framePtrs[i], out);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
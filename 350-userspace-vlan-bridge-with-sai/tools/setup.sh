@@ -33,6 +33,7 @@ set -euo pipefail
 NumPorts=4
 BaseIP="10.73.0"   # results in 10.73.0.X
 CSV_FILE="hostinfo.csv"
+PORT_CONFIG_FILE="switch_ports.conf"
 #######################################################################
 
 
@@ -47,7 +48,7 @@ cleanup() {
         ip netns del h$i 2>/dev/null || true
     done
 
-    rm -f "$CSV_FILE"
+    rm -f "$CSV_FILE" "$PORT_CONFIG_FILE"
 
     echo "[+] Cleanup complete."
 }
@@ -117,19 +118,20 @@ configure_namespaces() {
 
 
 #######################################################################
-# 4. Write uswitch config header
+# 4. Write uswitch port config
 #######################################################################
 write_uswitch_config() {
-    echo "[*] Writing uswitch config header..."
+    echo "[*] Writing uswitch port config..."
 
-    cat > src/switch_config.h <<EOF
-// Generated by tools/$0
-enum {
-    NumSwitchPorts = ${NumPorts}
-};
-EOF
+    {
+        echo "# Generated by tools/$0"
+        echo "# <interface> [weight=<n>] [tpid=0x8100|0x88a8] [storm-bcast|storm-mcast|storm-unknown=<n>pps|<n>[k|m|g]bps] [lag=<n>]"
+        for ((i=0; i<NumPorts; i++)); do
+            echo "veth$i"
+        done
+    } > "$PORT_CONFIG_FILE"
 
-    echo "[+] uswitch_config.h written to ../uswitch/ with NumSwitchPorts=${NumPorts}"
+    echo "[+] $PORT_CONFIG_FILE written with ${NumPorts} ports"
 }
 
 